@@ -0,0 +1,103 @@
+/* CTRBatch.c
+*
+ * Author: Nicolas Moura
+ * Created: 18/10/2026
+ *
+ * Many short messages under one key. A message of a few blocks alone
+ * never fills a key stream batch, so the counter blocks of consecutive
+ * messages are packed into the same batch and the interleaved kernels
+ * always have independent blocks to work on.
+ *
+ */
+
+#include "CTRBatch.h"
+
+// Part of a batch belonging to one message
+typedef struct
+{
+	const CTRMessage* message;
+	size_t offset;		// first byte of the message covered
+	size_t length;		// bytes covered, the last block may be partial
+} CTRBatchSegment;
+
+/*
+	Encrypts (or decrypts) every message with its own nonce under key.
+	Each message starts at the beginning of its key stream, its in and out
+	may be the same buffer, and empty messages are skipped.
+*/
+void CTRKey_updateBatch(const CTRKey* key, const CTRMessage* messages, size_t nrMessages)
+{
+	uint8_t counters[CTR_BATCH_BLOCKS * 16];
+	uint8_t keyStream[CTR_BATCH_BLOCKS * 16];
+	CTRBatchSegment segments[CTR_MAX_BATCH_BLOCKS];
+	uint32_t ctrNonce[4];
+	int bytes = key->blockBytes;
+	size_t batchBlocks = key->batchBlocks;
+	size_t message = 0;
+	size_t offset = 0;
+
+	// skip empty messages, then load the counter of the first one
+	while (message < nrMessages && messages[message].length == 0)
+	{
+		message++;
+	}
+	if (message < nrMessages)
+	{
+		memcpy(ctrNonce, messages[message].nonce, key->blockWords * sizeof(uint32_t));
+	}
+
+	while (message < nrMessages)
+	{
+		size_t filled = 0;
+		int nrSegments = 0;
+
+		// fill the batch with the next blocks of as many messages as needed
+		while (filled < batchBlocks && message < nrMessages)
+		{
+			const CTRMessage* current = &messages[message];
+			size_t left = current->length - offset;
+			size_t nrBlocks = (left + bytes - 1) / bytes;
+
+			if (nrBlocks > batchBlocks - filled)
+			{
+				nrBlocks = batchBlocks - filled;
+			}
+
+			CTRMode_counterBlocks(ctrNonce, key->blockWords, key->counterWords, counters + filled * bytes, nrBlocks);
+
+			segments[nrSegments].message = current;
+			segments[nrSegments].offset = offset;
+			segments[nrSegments].length = (nrBlocks * bytes < left) ? nrBlocks * bytes : left;
+			nrSegments++;
+
+			filled += nrBlocks;
+			offset += nrBlocks * bytes;
+
+			if (offset >= current->length)
+			{
+				offset = 0;
+				do
+				{
+					message++;
+				} while (message < nrMessages && messages[message].length == 0);
+
+				if (message < nrMessages)
+				{
+					memcpy(ctrNonce, messages[message].nonce, key->blockWords * sizeof(uint32_t));
+				}
+			}
+		}
+
+		key->encryptBlocks(key->keySchedule, counters, keyStream, filled);
+
+		filled = 0;
+		for (int i = 0; i < nrSegments; i++)
+		{
+			CTRBatchSegment* segment = &segments[i];
+
+			CTRMode_xorKeyStream(segment->message->in + segment->offset, keyStream + filled,
+				segment->message->out + segment->offset, segment->length);
+			filled += (segment->length + bytes - 1) / bytes * bytes;
+		}
+	}
+}
@@ -0,0 +1,23 @@
+/* CTRBatch.h
+*
+ * Author: Nicolas Moura
+ * Created: 18/10/2026
+ *
+ * Same key CTR over a batch of short messages.
+ *
+ */
+
+#pragma once
+
+#include "CTRMode.h"
+
+// One message of a same key batch, with its own nonce (first counter block)
+typedef struct
+{
+	const uint32_t* nonce;
+	const uint8_t* in;
+	uint8_t* out;
+	size_t length;			// in bytes
+} CTRMessage;
+
+void CTRKey_updateBatch(const CTRKey* key, const CTRMessage* messages, size_t nrMessages);
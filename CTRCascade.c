@@ -0,0 +1,89 @@
+/* CTRCascade.c
+*
+ * Author: Nicolas Moura
+ * Created: 18/10/2026
+ *
+ * Cascade of two ciphers in CTR mode in a single pass over the data. A
+ * batch of key stream of each cipher is generated into L1, the two are
+ * XORed together and the data is XORed once with the result.
+ *
+ */
+
+#include "CTRCascade.h"
+
+#define CASCADE_BATCH (CTR_BATCH_BLOCKS * 16)
+
+// Next batch of the combined key stream, the same number of bytes for 64 and 128 bits blocks
+static void cascadeKeyStream(CTRCascade* cascade, uint8_t* keyStream)
+{
+	uint8_t second[CASCADE_BATCH];
+
+	CTRState_keyStream(&cascade->first, keyStream, cascade->first.key->batchBlocks);
+	CTRState_keyStream(&cascade->second, second, cascade->second.key->batchBlocks);
+	CTRMode_xorKeyStream(keyStream, second, keyStream, CASCADE_BATCH);
+}
+
+/*
+	Starts the cascade of the streams (first, firstNonce) and (second,
+	secondNonce). The keys may use different ciphers and block sizes and
+	must stay valid until CTRCascade_final.
+*/
+void CTRCascade_init(CTRCascade* cascade, const CTRKey* first, const uint32_t* firstNonce, const CTRKey* second, const uint32_t* secondNonce)
+{
+	CTRState_init(&cascade->first, first, firstNonce);
+	CTRState_init(&cascade->second, second, secondNonce);
+	cascade->position = 0;
+}
+
+void CTRCascade_update(CTRCascade* cascade, const uint8_t* in, uint8_t* out, size_t length)
+{
+	uint8_t keyStream[CASCADE_BATCH];
+	size_t n;
+
+	if (cascade->position != 0)
+	{
+		n = CASCADE_BATCH - cascade->position;
+		if (n > length)
+		{
+			n = length;
+		}
+
+		CTRMode_xorKeyStream(in, cascade->keyStream + cascade->position, out, n);
+		cascade->position = (cascade->position + n) % CASCADE_BATCH;
+
+		in += n;
+		out += n;
+		length -= n;
+	}
+
+	while (length >= CASCADE_BATCH)
+	{
+		cascadeKeyStream(cascade, keyStream);
+		CTRMode_xorKeyStream(in, keyStream, out, CASCADE_BATCH);
+
+		in += CASCADE_BATCH;
+		out += CASCADE_BATCH;
+		length -= CASCADE_BATCH;
+	}
+
+	if (length != 0)
+	{
+		cascadeKeyStream(cascade, cascade->keyStream);
+		CTRMode_xorKeyStream(in, cascade->keyStream, out, length);
+		cascade->position = length;
+	}
+}
+
+void CTRCascade_final(CTRCascade* cascade)
+{
+	CTRMode_wipe(cascade->keyStream, CASCADE_BATCH);
+
+	for (int i = 0; i < 4; i++)
+	{
+		cascade->first.nonce[i] = 0;
+		cascade->first.ctrNonce[i] = 0;
+		cascade->second.nonce[i] = 0;
+		cascade->second.ctrNonce[i] = 0;
+	}
+	cascade->position = 0;
+}
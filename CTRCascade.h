@@ -0,0 +1,31 @@
+/* CTRCascade.h
+*
+ * Author: Nicolas Moura
+ * Created: 18/10/2026
+ *
+ * Cascade of two ciphers in CTR mode.
+ *
+ */
+
+#pragma once
+
+#include "CTRMode.h"
+
+/*
+	Cascade of two ciphers in CTR mode
+
+	The output is the input XOR both key streams. They are generated batch
+	by batch (CTR_BATCH_BLOCKS * 16 bytes, whatever the block sizes) and
+	combined in L1, so the data itself is read and written only once.
+*/
+typedef struct
+{
+	CTRState first;
+	CTRState second;
+	uint8_t keyStream[CTR_BATCH_BLOCKS * 16];	// combined key stream of the current batch
+	size_t position;		// bytes already used from keyStream, 0 when none is pending
+} CTRCascade;
+
+void CTRCascade_init(CTRCascade* cascade, const CTRKey* first, const uint32_t* firstNonce, const CTRKey* second, const uint32_t* secondNonce);
+void CTRCascade_update(CTRCascade* cascade, const uint8_t* in, uint8_t* out, size_t length);
+void CTRCascade_final(CTRCascade* cascade);
@@ -0,0 +1,248 @@
+/* CTRCbc.c
+*
+ * Author: Nicolas Moura
+ * Created: 18/10/2026
+ *
+ * ECB and CBC on any cipher of the library, mainly to read data produced
+ * by other systems. CBC encryption is a chain and stays serial, but CBC
+ * decryption only needs the previous ciphertext block, so like ECB it
+ * goes through the multi-block decryption kernel one batch at a time and
+ * can be split across the threads of a CTRPool.
+ *
+ */
+
+#include "CTRCbc.h"
+
+// Job of the pool: every chunk goes through crypt, CBC chunks also XOR with the previous ciphertext
+typedef struct
+{
+	const CTRKey* key;
+	CipherEncryptBlocks crypt;
+	const uint8_t* chain;	// ciphertext block before every chunk, NULL for ECB
+} BlockJob;
+
+// Blocks per thread of a parallel job, in whole batches
+static size_t chunkSize(const CTRPool* pool, const CTRKey* key, size_t nrBlocks)
+{
+	size_t chunkBlocks = (nrBlocks + pool->nrThreads - 1) / pool->nrThreads;
+
+	return (chunkBlocks + key->batchBlocks - 1) / key->batchBlocks * key->batchBlocks;
+}
+
+/*
+	Decrypts nrBlocks CBC blocks, iv being the ciphertext block before the
+	first one; iv receives the last ciphertext block. Each batch is
+	decrypted into a buffer first, so out may be the same buffer as in.
+*/
+static void cbcDecrypt(const CTRKey* key, uint8_t* iv, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	uint8_t buffer[CTR_BATCH_BLOCKS * 16];
+	int bytes = key->blockBytes;
+	size_t n;
+
+	while (nrBlocks > 0)
+	{
+		n = (nrBlocks < (size_t)key->batchBlocks) ? nrBlocks : (size_t)key->batchBlocks;
+
+		key->cipher->decryptBlocks(key->keySchedule, in, buffer, n);
+		CTRMode_xorKeyStream(buffer, iv, buffer, bytes);
+		CTRMode_xorKeyStream(buffer + bytes, in, buffer + bytes, (n - 1) * bytes);
+
+		// the next chain block, read before out may overwrite it
+		memcpy(iv, in + (n - 1) * bytes, bytes);
+		memcpy(out, buffer, n * bytes);
+
+		in += n * bytes;
+		out += n * bytes;
+		nrBlocks -= n;
+	}
+
+	CTRMode_wipe(buffer, sizeof(buffer));
+}
+
+// Runs the chunk of the current job assigned to index
+static void runChunk(CTRPool* pool, int index)
+{
+	const BlockJob* job = pool->data;
+	int bytes = job->key->blockBytes;
+	size_t first = (size_t)index * pool->chunkBlocks;
+	size_t nrBlocks;
+	uint8_t chain[16];
+
+	if (first >= pool->nrBlocks)
+	{
+		return;
+	}
+
+	nrBlocks = pool->nrBlocks - first;
+	if (nrBlocks > pool->chunkBlocks)
+	{
+		nrBlocks = pool->chunkBlocks;
+	}
+
+	if (job->chain == NULL)
+	{
+		job->crypt(job->key->keySchedule, pool->in + first * bytes, pool->out + first * bytes, nrBlocks);
+		return;
+	}
+
+	memcpy(chain, job->chain + (size_t)index * bytes, bytes);
+	cbcDecrypt(job->key, chain, pool->in + first * bytes, pool->out + first * bytes, nrBlocks);
+}
+
+// Runs crypt over nrBlocks blocks on the threads of pool
+static void ecbParallel(CTRPool* pool, const CTRKey* key, CipherEncryptBlocks crypt, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	BlockJob job;
+
+	if (pool->nrThreads == 1 || nrBlocks < CTR_PARALLEL_MIN_BLOCKS)
+	{
+		crypt(key->keySchedule, in, out, nrBlocks);
+		return;
+	}
+
+	job.key = key;
+	job.crypt = crypt;
+	job.chain = NULL;
+	CTRPool_run(pool, runChunk, &job, in, out, nrBlocks, chunkSize(pool, key, nrBlocks));
+}
+
+/*
+	Encrypts length bytes of in to out (may be the same buffer) block by
+	block. length must be a multiple of the block size, returns -1 if not.
+*/
+int CTREcb_encrypt(const CTRKey* key, const uint8_t* in, uint8_t* out, size_t length)
+{
+	if (length % key->blockBytes != 0)
+	{
+		return -1;
+	}
+
+	key->encryptBlocks(key->keySchedule, in, out, length / key->blockBytes);
+	return 0;
+}
+
+// Returns -1 if length is not a multiple of the block size or the cipher cannot decrypt
+int CTREcb_decrypt(const CTRKey* key, const uint8_t* in, uint8_t* out, size_t length)
+{
+	if (length % key->blockBytes != 0 || key->cipher->decryptBlocks == NULL)
+	{
+		return -1;
+	}
+
+	key->cipher->decryptBlocks(key->keySchedule, in, out, length / key->blockBytes);
+	return 0;
+}
+
+int CTREcb_encryptParallel(CTRPool* pool, const CTRKey* key, const uint8_t* in, uint8_t* out, size_t length)
+{
+	if (length % key->blockBytes != 0)
+	{
+		return -1;
+	}
+
+	ecbParallel(pool, key, key->encryptBlocks, in, out, length / key->blockBytes);
+	return 0;
+}
+
+int CTREcb_decryptParallel(CTRPool* pool, const CTRKey* key, const uint8_t* in, uint8_t* out, size_t length)
+{
+	if (length % key->blockBytes != 0 || key->cipher->decryptBlocks == NULL)
+	{
+		return -1;
+	}
+
+	ecbParallel(pool, key, key->cipher->decryptBlocks, in, out, length / key->blockBytes);
+	return 0;
+}
+
+/*
+	Encrypts length bytes of in to out (may be the same buffer). iv holds
+	one block and receives the last ciphertext block, so a message can be
+	encrypted in several calls. length must be a multiple of the block
+	size, returns -1 if not.
+*/
+int CTRCbc_encrypt(const CTRKey* key, uint8_t* iv, const uint8_t* in, uint8_t* out, size_t length)
+{
+	int bytes = key->blockBytes;
+
+	if (length % bytes != 0)
+	{
+		return -1;
+	}
+
+	for (; length > 0; length -= bytes, in += bytes, out += bytes)
+	{
+		CTRMode_xorKeyStream(in, iv, out, bytes);
+		key->encryptBlocks(key->keySchedule, out, out, 1);
+		memcpy(iv, out, bytes);
+	}
+
+	return 0;
+}
+
+// Decrypts in to out as CTRCbc_encrypt, returns -1 when the cipher cannot decrypt
+int CTRCbc_decrypt(const CTRKey* key, uint8_t* iv, const uint8_t* in, uint8_t* out, size_t length)
+{
+	if (length % key->blockBytes != 0 || key->cipher->decryptBlocks == NULL)
+	{
+		return -1;
+	}
+
+	cbcDecrypt(key, iv, in, out, length / key->blockBytes);
+	return 0;
+}
+
+/*
+	CTRCbc_decrypt on the threads of pool. The ciphertext block before
+	every chunk is copied first, so out may still be the same buffer as in.
+*/
+int CTRCbc_decryptParallel(CTRPool* pool, const CTRKey* key, uint8_t* iv, const uint8_t* in, uint8_t* out, size_t length)
+{
+	int bytes = key->blockBytes;
+	size_t nrBlocks = length / bytes;
+	size_t chunkBlocks;
+	uint8_t* chain;
+	BlockJob job;
+
+	if (length % bytes != 0 || key->cipher->decryptBlocks == NULL)
+	{
+		return -1;
+	}
+
+	if (pool->nrThreads == 1 || nrBlocks < CTR_PARALLEL_MIN_BLOCKS)
+	{
+		cbcDecrypt(key, iv, in, out, nrBlocks);
+		return 0;
+	}
+
+	chain = malloc((size_t)pool->nrThreads * bytes);
+	if (chain == NULL)
+	{
+		cbcDecrypt(key, iv, in, out, nrBlocks);
+		return 0;
+	}
+
+	chunkBlocks = chunkSize(pool, key, nrBlocks);
+	memcpy(chain, iv, bytes);
+	for (int i = 1; i < pool->nrThreads; i++)
+	{
+		size_t first = (size_t)i * chunkBlocks;
+
+		if (first < nrBlocks)
+		{
+			memcpy(chain + (size_t)i * bytes, in + (first - 1) * bytes, bytes);
+		}
+	}
+
+	// the last ciphertext block is the next iv, read before out may overwrite it
+	memcpy(iv, in + (nrBlocks - 1) * bytes, bytes);
+
+	job.key = key;
+	job.crypt = key->cipher->decryptBlocks;
+	job.chain = chain;
+	CTRPool_run(pool, runChunk, &job, in, out, nrBlocks, chunkBlocks);
+
+	free(chain);
+	return 0;
+}
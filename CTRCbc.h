@@ -0,0 +1,20 @@
+/* CTRCbc.h
+*
+ * Author: Nicolas Moura
+ * Created: 18/10/2026
+ *
+ * ECB and CBC modes, with parallel decryption on a CTRPool.
+ *
+ */
+
+#pragma once
+
+#include "CTRParallel.h"
+
+int CTREcb_encrypt(const CTRKey* key, const uint8_t* in, uint8_t* out, size_t length);
+int CTREcb_decrypt(const CTRKey* key, const uint8_t* in, uint8_t* out, size_t length);
+int CTREcb_encryptParallel(CTRPool* pool, const CTRKey* key, const uint8_t* in, uint8_t* out, size_t length);
+int CTREcb_decryptParallel(CTRPool* pool, const CTRKey* key, const uint8_t* in, uint8_t* out, size_t length);
+int CTRCbc_encrypt(const CTRKey* key, uint8_t* iv, const uint8_t* in, uint8_t* out, size_t length);
+int CTRCbc_decrypt(const CTRKey* key, uint8_t* iv, const uint8_t* in, uint8_t* out, size_t length);
+int CTRCbc_decryptParallel(CTRPool* pool, const CTRKey* key, uint8_t* iv, const uint8_t* in, uint8_t* out, size_t length);
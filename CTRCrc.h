@@ -0,0 +1,16 @@
+/* CTRCrc.h
+*
+ * Author: Nicolas Moura
+ * Created: 18/10/2026
+ *
+ * CRC32C, alone or fused with the CTR XOR pass.
+ *
+ */
+
+#pragma once
+
+#include "CTRMode.h"
+
+uint32_t CTRCrc_update(uint32_t crc, const uint8_t* data, size_t length);
+uint32_t CTRCrc_encrypt(CTRState* state, const uint8_t* in, uint8_t* out, size_t length, uint32_t crc);
+uint32_t CTRCrc_decrypt(CTRState* state, const uint8_t* in, uint8_t* out, size_t length, uint32_t crc);
@@ -0,0 +1,234 @@
+/* CTRDrbg.c
+*
+ * Author: Nicolas Moura
+ * Created: 18/10/2026
+ *
+ * CTR_DRBG of NIST SP 800-90A (no derivation function) on the 128 bits
+ * ciphers of the library. The output of a request is the key stream of
+ * the counter V + 1, V + 2, ..., so it is generated in batches by the
+ * same kernels as CTR mode, and only the update between requests works
+ * block by block.
+ *
+ */
+
+#include "CTRDrbg.h"
+
+// seedlen is at most 256 + 128 bits
+#define DRBG_MAX_SEED 48
+
+// Key stream of nrBlocks blocks from V + 1, V is left on the last block used
+static void drbgKeyStream(CTRDrbg* drbg, uint8_t* out, size_t nrBlocks)
+{
+	CTRState state;
+
+	CTRState_init(&state, &drbg->key, drbg->v);
+	CTRMode_addCounter(state.ctrNonce, 4, 4, 1);
+	CTRState_keyStream(&state, out, nrBlocks);
+
+	CTRMode_addCounter(drbg->v, 4, 4, nrBlocks);
+	CTRMode_wipe(&state, sizeof(state));
+}
+
+// CTR_DRBG_Update: (Key, V) = leftmost seedlen bits of the next key stream ^ data
+static void drbgUpdate(CTRDrbg* drbg, const uint8_t* data)
+{
+	uint8_t temp[DRBG_MAX_SEED];
+	uint32_t keyWords[8];
+	int keyBytes = drbg->seedBytes - 16;
+
+	drbgKeyStream(drbg, temp, (drbg->seedBytes + 15) / 16);
+	CTRMode_xorKeyStream(temp, data, temp, drbg->seedBytes);
+
+	for (int i = 0; i < keyBytes / 4; i++)
+	{
+		keyWords[i] = LOAD32_BE(temp + 4 * i);
+	}
+	for (int i = 0; i < 4; i++)
+	{
+		drbg->v[i] = LOAD32_BE(temp + keyBytes + 4 * i);
+	}
+
+	// the generator is never shared between threads, it alone uses its key
+	CTRKey_rekey(&drbg->key, keyWords);
+
+	CTRMode_wipe(temp, sizeof(temp));
+	CTRMode_wipe(keyWords, sizeof(keyWords));
+}
+
+// seedlen bytes of input ^ data, data shorter than seedlen being padded with zeros
+static int seedMaterial(const CTRDrbg* drbg, uint8_t* material, const uint8_t* input, const uint8_t* data, size_t dataLength)
+{
+	if (dataLength > (size_t)drbg->seedBytes)
+	{
+		return -1;
+	}
+
+	for (int i = 0; i < drbg->seedBytes; i++)
+	{
+		material[i] = (input != NULL) ? input[i] : 0;
+	}
+	for (size_t i = 0; i < dataLength; i++)
+	{
+		material[i] ^= data[i];
+	}
+
+	return 0;
+}
+
+/*
+	Instantiates the generator. entropy holds seedlen = key size + 128
+	bits, the optional personalization string at most as many.
+*/
+int CTRDrbg_init(CTRDrbg* drbg, enum Algorithm algorithm, const uint8_t* entropy, const uint8_t* personalization, size_t personalizationLength)
+{
+	uint8_t material[DRBG_MAX_SEED];
+	uint32_t zero[8] = { 0 };
+
+	if (CTRKey_init(&drbg->key, algorithm, zero) != 0)
+	{
+		return -1;
+	}
+
+	if (drbg->key.blockBytes != 16)
+	{
+		CTRKey_final(&drbg->key);
+		return -1;
+	}
+
+	drbg->seedBytes = drbg->key.keySize / 8 + 16;
+	if (seedMaterial(drbg, material, entropy, personalization, personalizationLength) != 0)
+	{
+		CTRKey_final(&drbg->key);
+		return -1;
+	}
+
+	for (int i = 0; i < 4; i++)
+	{
+		drbg->v[i] = 0;
+	}
+
+	drbgUpdate(drbg, material);
+	drbg->reseedCounter = 1;
+	drbg->available = 0;
+
+	CTRMode_wipe(material, sizeof(material));
+	return 0;
+}
+
+int CTRDrbg_reseed(CTRDrbg* drbg, const uint8_t* entropy, const uint8_t* additional, size_t additionalLength)
+{
+	uint8_t material[DRBG_MAX_SEED];
+
+	if (seedMaterial(drbg, material, entropy, additional, additionalLength) != 0)
+	{
+		return -1;
+	}
+
+	drbgUpdate(drbg, material);
+	drbg->reseedCounter = 1;
+
+	// buffered output belongs to the previous seed
+	CTRMode_wipe(drbg->buffer, sizeof(drbg->buffer));
+	drbg->available = 0;
+
+	CTRMode_wipe(material, sizeof(material));
+	return 0;
+}
+
+/*
+	Fills out with length bytes. Outputs longer than CTR_DRBG_MAX_REQUEST
+	are split into several requests, each one followed by its update.
+	Returns -1 when the generator has to be reseeded first (or the
+	additional input is too long), 0 otherwise.
+*/
+int CTRDrbg_generate(CTRDrbg* drbg, uint8_t* out, size_t length, const uint8_t* additional, size_t additionalLength)
+{
+	uint8_t material[DRBG_MAX_SEED];
+	uint8_t block[16];
+	size_t request;
+
+	if (seedMaterial(drbg, material, NULL, additional, additionalLength) != 0)
+	{
+		return -1;
+	}
+
+	do
+	{
+		if (drbg->reseedCounter > CTR_DRBG_RESEED_INTERVAL)
+		{
+			CTRMode_wipe(material, sizeof(material));
+			return -1;
+		}
+
+		if (additionalLength != 0)
+		{
+			drbgUpdate(drbg, material);
+		}
+
+		request = (length < CTR_DRBG_MAX_REQUEST) ? length : CTR_DRBG_MAX_REQUEST;
+
+		// whole blocks straight into out, the last partial one through block
+		drbgKeyStream(drbg, out, request / 16);
+		if (request % 16 != 0)
+		{
+			drbgKeyStream(drbg, block, 1);
+			memcpy(out + request / 16 * 16, block, request % 16);
+		}
+
+		drbgUpdate(drbg, material);
+		drbg->reseedCounter++;
+
+		out += request;
+		length -= request;
+	} while (length > 0);
+
+	CTRMode_wipe(block, sizeof(block));
+	CTRMode_wipe(material, sizeof(material));
+	return 0;
+}
+
+/*
+	Buffered output for many small requests: bytes are taken from a
+	buffer refilled by one CTR_DRBG_BUFFER bytes request, and wiped once
+	handed out. Long outputs go straight to CTRDrbg_generate.
+*/
+int CTRDrbg_random(CTRDrbg* drbg, uint8_t* out, size_t length)
+{
+	size_t n;
+
+	while (length > 0)
+	{
+		if (drbg->available == 0)
+		{
+			if (length >= CTR_DRBG_BUFFER)
+			{
+				return CTRDrbg_generate(drbg, out, length, NULL, 0);
+			}
+
+			if (CTRDrbg_generate(drbg, drbg->buffer, CTR_DRBG_BUFFER, NULL, 0) != 0)
+			{
+				return -1;
+			}
+			drbg->available = CTR_DRBG_BUFFER;
+		}
+
+		n = (length < drbg->available) ? length : drbg->available;
+		memcpy(out, drbg->buffer + CTR_DRBG_BUFFER - drbg->available, n);
+		CTRMode_wipe(drbg->buffer + CTR_DRBG_BUFFER - drbg->available, n);
+		drbg->available -= n;
+
+		out += n;
+		length -= n;
+	}
+
+	return 0;
+}
+
+void CTRDrbg_final(CTRDrbg* drbg)
+{
+	CTRMode_wipe(drbg->buffer, sizeof(drbg->buffer));
+	CTRMode_wipe(drbg->v, sizeof(drbg->v));
+	drbg->available = 0;
+	drbg->reseedCounter = 0;
+	CTRKey_final(&drbg->key);
+}
@@ -0,0 +1,45 @@
+/* CTRDrbg.h
+*
+ * Author: Nicolas Moura
+ * Created: 18/10/2026
+ *
+ * CTR_DRBG (NIST SP 800-90A) on a 128 bits block cipher.
+ *
+ */
+
+#pragma once
+
+#include "CTRMode.h"
+
+// bytes per CTRDrbg generate request (2^19 bits), longer outputs are split
+#define CTR_DRBG_MAX_REQUEST 65536
+
+// requests allowed between two reseeds
+#define CTR_DRBG_RESEED_INTERVAL (1ull << 48)
+
+// bytes generated at once to serve the small requests of CTRDrbg_random
+#define CTR_DRBG_BUFFER 4096
+
+/*
+	CTR_DRBG (NIST SP 800-90A, without derivation function) on a 128 bits
+	block cipher
+
+	Every request is generated with the multi-block key stream path and
+	followed by the update of (Key, V). A generator is not shared between
+	threads: each thread keeps its own, with its own output buffer.
+*/
+typedef struct
+{
+	CTRKey key;							// Key, expanded again by every update
+	uint32_t v[4];						// V
+	uint64_t reseedCounter;
+	int seedBytes;						// key bytes + 16
+	uint8_t buffer[CTR_DRBG_BUFFER];	// output generated but not handed out yet
+	size_t available;					// bytes left at the end of buffer
+} CTRDrbg;
+
+int CTRDrbg_init(CTRDrbg* drbg, enum Algorithm algorithm, const uint8_t* entropy, const uint8_t* personalization, size_t personalizationLength);
+int CTRDrbg_reseed(CTRDrbg* drbg, const uint8_t* entropy, const uint8_t* additional, size_t additionalLength);
+int CTRDrbg_generate(CTRDrbg* drbg, uint8_t* out, size_t length, const uint8_t* additional, size_t additionalLength);
+int CTRDrbg_random(CTRDrbg* drbg, uint8_t* out, size_t length);
+void CTRDrbg_final(CTRDrbg* drbg);
@@ -0,0 +1,412 @@
+/* CTRGcm.c
+*
+ * Author: Nicolas Moura
+ * Created: 18/10/2026
+ *
+ * GCM (NIST SP 800-38D) on the 128 bits ciphers of the library. The
+ * data is processed one key stream batch at a time: the batch is
+ * encrypted and hashed while it is still in L1, so the buffer is read
+ * and written only once. GHASH uses PCLMULQDQ with eight blocks per
+ * reduction when available, the bitwise multiplication otherwise.
+ *
+ */
+
+#include "CTRGcm.h"
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
+#define GCM_BATCH (CTR_BATCH_BLOCKS * 16)
+
+#ifdef __x86_64__
+
+// the CPU has PCLMULQDQ and SSSE3, checked once at load time
+static int clmulSupported;
+
+__attribute__((constructor))
+static void detectClmul(void)
+{
+	__builtin_cpu_init();
+	clmulSupported = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3");
+}
+
+#endif
+
+// x = x * h in GF(2^128), bit 0 being the most significant bit of x[0]
+static void gfMultiply(uint64_t* x, const uint64_t* h)
+{
+	uint64_t z0 = 0, z1 = 0;
+	uint64_t v0 = h[0], v1 = h[1];
+	uint64_t word;
+	uint64_t lsb;
+
+	for (int i = 0; i < 128; i++)
+	{
+		word = (i < 64) ? x[0] : x[1];
+		if ((word >> (63 - (i % 64))) & 1)
+		{
+			z0 ^= v0;
+			z1 ^= v1;
+		}
+
+		lsb = v1 & 1;
+		v1 = (v1 >> 1) | (v0 << 63);
+		v0 = (v0 >> 1) ^ (lsb ? 0xe100000000000000ull : 0);
+	}
+
+	x[0] = z0;
+	x[1] = z1;
+}
+
+static void ghashPortable(const CTRGcm* gcm, uint8_t* y, const uint8_t* data, size_t nrBlocks)
+{
+	uint64_t x[2];
+
+	x[0] = LOAD64_BE(y);
+	x[1] = LOAD64_BE(y + 8);
+
+	for (size_t i = 0; i < nrBlocks; i++, data += 16)
+	{
+		x[0] ^= LOAD64_BE(data);
+		x[1] ^= LOAD64_BE(data + 8);
+		gfMultiply(x, gcm->h);
+	}
+
+	STORE64_BE(y, x[0]);
+	STORE64_BE(y + 8, x[1]);
+}
+
+#ifdef __x86_64__
+
+/*
+	Carry-less multiplication of byte reversed operands, accumulated
+	unreduced into (lo, hi): the reduction is linear, so the products of
+	several blocks share a single one.
+*/
+__attribute__((target("pclmul,ssse3")))
+static inline void clmulAccumulate(__m128i a, __m128i b, __m128i* lo, __m128i* hi)
+{
+	__m128i low = _mm_clmulepi64_si128(a, b, 0x00);
+	__m128i middle = _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x10), _mm_clmulepi64_si128(a, b, 0x01));
+	__m128i high = _mm_clmulepi64_si128(a, b, 0x11);
+
+	*lo = _mm_xor_si128(*lo, _mm_xor_si128(low, _mm_slli_si128(middle, 8)));
+	*hi = _mm_xor_si128(*hi, _mm_xor_si128(high, _mm_srli_si128(middle, 8)));
+}
+
+// Shifts the 256 bits product left by one (bit reflected operands) and reduces it modulo the GCM polynomial
+__attribute__((target("pclmul,ssse3")))
+static inline __m128i clmulReduce(__m128i lo, __m128i hi)
+{
+	__m128i t1, t2, t3;
+
+	t1 = _mm_srli_epi32(lo, 31);
+	t2 = _mm_srli_epi32(hi, 31);
+	lo = _mm_slli_epi32(lo, 1);
+	hi = _mm_slli_epi32(hi, 1);
+	t3 = _mm_srli_si128(t1, 12);
+	t2 = _mm_slli_si128(t2, 4);
+	t1 = _mm_slli_si128(t1, 4);
+	lo = _mm_or_si128(lo, t1);
+	hi = _mm_or_si128(_mm_or_si128(hi, t2), t3);
+
+	t1 = _mm_xor_si128(_mm_xor_si128(_mm_slli_epi32(lo, 31), _mm_slli_epi32(lo, 30)), _mm_slli_epi32(lo, 25));
+	t2 = _mm_srli_si128(t1, 4);
+	lo = _mm_xor_si128(lo, _mm_slli_si128(t1, 12));
+
+	t1 = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi32(lo, 1), _mm_srli_epi32(lo, 2)), _mm_srli_epi32(lo, 7));
+	lo = _mm_xor_si128(lo, _mm_xor_si128(t1, t2));
+
+	return _mm_xor_si128(hi, lo);
+}
+
+__attribute__((target("pclmul,ssse3")))
+static __m128i clmulMultiply(__m128i a, __m128i b)
+{
+	__m128i lo = _mm_setzero_si128();
+	__m128i hi = _mm_setzero_si128();
+
+	clmulAccumulate(a, b, &lo, &hi);
+	return clmulReduce(lo, hi);
+}
+
+// H^1 .. H^8 for the aggregated reduction
+__attribute__((target("pclmul,ssse3")))
+static void clmulPowers(CTRGcm* gcm, const uint8_t* h)
+{
+	const __m128i reverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	__m128i h1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)h), reverse);
+	__m128i power = h1;
+
+	for (int i = 0; i < CTR_GCM_AGGREGATE; i++)
+	{
+		_mm_store_si128((__m128i*)gcm->hPowers[i], power);
+		power = clmulMultiply(power, h1);
+	}
+}
+
+__attribute__((target("pclmul,ssse3")))
+static void ghashClmul(const CTRGcm* gcm, uint8_t* y, const uint8_t* data, size_t nrBlocks)
+{
+	const __m128i reverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	const __m128i* powers = (const __m128i*)gcm->hPowers;
+	__m128i x = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)y), reverse);
+	__m128i block, lo, hi;
+
+	// Y = (Y ^ X0) H^8 ^ X1 H^7 ^ ... ^ X7 H, one reduction for the eight blocks
+	for (; nrBlocks >= CTR_GCM_AGGREGATE; nrBlocks -= CTR_GCM_AGGREGATE, data += 16 * CTR_GCM_AGGREGATE)
+	{
+		lo = _mm_setzero_si128();
+		hi = _mm_setzero_si128();
+
+		for (int i = 0; i < CTR_GCM_AGGREGATE; i++)
+		{
+			block = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16 * i)), reverse);
+			if (i == 0)
+			{
+				block = _mm_xor_si128(block, x);
+			}
+			clmulAccumulate(block, _mm_load_si128(&powers[CTR_GCM_AGGREGATE - 1 - i]), &lo, &hi);
+		}
+
+		x = clmulReduce(lo, hi);
+	}
+
+	for (; nrBlocks > 0; nrBlocks--, data += 16)
+	{
+		block = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)data), reverse);
+		x = clmulMultiply(_mm_xor_si128(x, block), _mm_load_si128(&powers[0]));
+	}
+
+	_mm_storeu_si128((__m128i*)y, _mm_shuffle_epi8(x, reverse));
+}
+
+#endif
+
+static void ghash(const CTRGcm* gcm, uint8_t* y, const uint8_t* data, size_t nrBlocks)
+{
+#ifdef __x86_64__
+	if (gcm->clmul)
+	{
+		ghashClmul(gcm, y, data, nrBlocks);
+		return;
+	}
+#endif
+
+	ghashPortable(gcm, y, data, nrBlocks);
+}
+
+// GHASH of length bytes, the last block padded with zeros
+static void ghashPadded(const CTRGcm* gcm, uint8_t* y, const uint8_t* data, size_t length)
+{
+	uint8_t block[16] = { 0 };
+
+	ghash(gcm, y, data, length / 16);
+
+	if (length % 16 != 0)
+	{
+		memcpy(block, data + length / 16 * 16, length % 16);
+		ghash(gcm, y, block, 1);
+	}
+}
+
+// Counter block J0 for iv
+static void counterBlock(const CTRGcm* gcm, const uint8_t* iv, size_t ivLength, uint32_t* j0)
+{
+	uint8_t y[16] = { 0 };
+	uint8_t lengths[16] = { 0 };
+
+	if (ivLength == 12)
+	{
+		j0[0] = LOAD32_BE(iv);
+		j0[1] = LOAD32_BE(iv + 4);
+		j0[2] = LOAD32_BE(iv + 8);
+		j0[3] = 1;
+		return;
+	}
+
+	ghashPadded(gcm, y, iv, ivLength);
+	STORE64_BE(lengths + 8, (uint64_t)ivLength * 8);
+	ghash(gcm, y, lengths, 1);
+
+	for (int i = 0; i < 4; i++)
+	{
+		j0[i] = LOAD32_BE(y + 4 * i);
+	}
+}
+
+/*
+	Encrypts (encrypt != 0) or decrypts in to out and leaves the full tag
+	in tag. The ciphertext is hashed batch by batch, right after it is
+	produced or right before it is decrypted.
+*/
+static void gcmCrypt(const CTRGcm* gcm, const uint8_t* iv, size_t ivLength, const uint8_t* aad, size_t aadLength,
+	const uint8_t* in, uint8_t* out, size_t length, uint8_t* tag, int encrypt)
+{
+	uint8_t y[16] = { 0 };
+	uint8_t lengths[16];
+	uint8_t j0Block[16];
+	uint32_t j0[4];
+	CTRState state;
+	size_t total = length;
+	size_t n;
+
+	counterBlock(gcm, iv, ivLength, j0);
+
+	// the data starts at inc32(J0), J0 itself masks the tag
+	CTRState_init(&state, &gcm->key, j0);
+	CTRState_keyStream(&state, j0Block, 1);
+
+	ghashPadded(gcm, y, aad, aadLength);
+
+	while (length > 0)
+	{
+		n = (length < GCM_BATCH) ? length : GCM_BATCH;
+
+		if (!encrypt)
+		{
+			ghashPadded(gcm, y, in, n);
+		}
+		CTRState_update(&state, in, out, n);
+		if (encrypt)
+		{
+			ghashPadded(gcm, y, out, n);
+		}
+
+		in += n;
+		out += n;
+		length -= n;
+	}
+
+	STORE64_BE(lengths, (uint64_t)aadLength * 8);
+	STORE64_BE(lengths + 8, (uint64_t)total * 8);
+	ghash(gcm, y, lengths, 1);
+
+	CTRMode_xorKeyStream(y, j0Block, tag, 16);
+
+	CTRMode_wipe(&state, sizeof(state));
+	CTRMode_wipe(j0Block, sizeof(j0Block));
+}
+
+// Expands key, which must be of a 128 bits block cipher, and precomputes H
+int CTRGcm_init(CTRGcm* gcm, enum Algorithm algorithm, const uint32_t* key)
+{
+	uint8_t zero[16] = { 0 };
+	uint8_t h[16];
+
+	if (CTRKey_initLayout(&gcm->key, algorithm, key, CTR_COUNTER_32) != 0)
+	{
+		return -1;
+	}
+
+	if (gcm->key.blockBytes != 16)
+	{
+		CTRKey_final(&gcm->key);
+		return -1;
+	}
+
+	gcm->key.encryptBlocks(gcm->key.keySchedule, zero, h, 1);
+	gcm->h[0] = LOAD64_BE(h);
+	gcm->h[1] = LOAD64_BE(h + 8);
+	gcm->clmul = 0;
+	gcm->shortTags = 0;
+
+#ifdef __x86_64__
+	if (clmulSupported)
+	{
+		clmulPowers(gcm, h);
+		gcm->clmul = 1;
+	}
+#endif
+
+	CTRMode_wipe(h, sizeof(h));
+	return 0;
+}
+
+/*
+	Lets CTRGcm_decrypt accept 8 and 4 bytes tags, which SP 800-38D only
+	allows for applications that bound the number of forgery attempts and
+	the length of the messages (Appendix C). Call it before gcm is shared.
+*/
+void CTRGcm_allowShortTags(CTRGcm* gcm)
+{
+	gcm->shortTags = 1;
+}
+
+// The IV is not empty and the data fits in the 32 bits counter after J0
+static int validMessage(size_t ivLength, size_t length)
+{
+	return ivLength != 0 && (uint64_t)(length / 16 + (length % 16 != 0)) <= CTR_GCM_MAX_BLOCKS;
+}
+
+/*
+	Encrypts length bytes of in to out (may be the same buffer) and writes
+	the 16 bytes tag. Returns -1, without encrypting, for an empty IV or
+	more than CTR_GCM_MAX_BLOCKS blocks of data.
+*/
+int CTRGcm_encrypt(const CTRGcm* gcm, const uint8_t* iv, size_t ivLength, const uint8_t* aad, size_t aadLength,
+	const uint8_t* in, uint8_t* out, size_t length, uint8_t* tag)
+{
+	if (!validMessage(ivLength, length))
+	{
+		return -1;
+	}
+
+	gcmCrypt(gcm, iv, ivLength, aad, aadLength, in, out, length, tag, 1);
+	return 0;
+}
+
+// Tag lengths of SP 800-38D: 16 down to 12 bytes, 8 and 4 only when allowed
+static int validTagLength(const CTRGcm* gcm, size_t tagLength)
+{
+	if (tagLength >= CTR_GCM_MIN_TAG_SIZE && tagLength <= CTR_GCM_TAG_SIZE)
+	{
+		return 1;
+	}
+
+	return gcm->shortTags && (tagLength == 8 || tagLength == 4);
+}
+
+/*
+	Decrypts in to out and checks the first tagLength bytes of the tag.
+	Returns 0 when it matches; otherwise -1, with out wiped. Tags shorter
+	than CTR_GCM_MIN_TAG_SIZE bytes, an empty IV and over long messages
+	are rejected in the same way.
+*/
+int CTRGcm_decrypt(const CTRGcm* gcm, const uint8_t* iv, size_t ivLength, const uint8_t* aad, size_t aadLength,
+	const uint8_t* in, uint8_t* out, size_t length, const uint8_t* tag, size_t tagLength)
+{
+	uint8_t expected[16];
+	uint8_t diff = 0;
+
+	if (!validTagLength(gcm, tagLength) || !validMessage(ivLength, length))
+	{
+		CTRMode_wipe(out, length);
+		return -1;
+	}
+
+	gcmCrypt(gcm, iv, ivLength, aad, aadLength, in, out, length, expected, 0);
+
+	// constant time comparison
+	for (size_t i = 0; i < tagLength; i++)
+	{
+		diff |= expected[i] ^ tag[i];
+	}
+	CTRMode_wipe(expected, sizeof(expected));
+
+	if (diff != 0)
+	{
+		CTRMode_wipe(out, length);
+		return -1;
+	}
+
+	return 0;
+}
+
+void CTRGcm_final(CTRGcm* gcm)
+{
+	CTRMode_wipe(gcm->h, sizeof(gcm->h));
+	CTRMode_wipe(gcm->hPowers, sizeof(gcm->hPowers));
+	CTRKey_final(&gcm->key);
+}
@@ -0,0 +1,48 @@
+/* CTRGcm.h
+*
+ * Author: Nicolas Moura
+ * Created: 18/10/2026
+ *
+ * GCM authenticated encryption on a 128 bits block cipher.
+ *
+ */
+
+#pragma once
+
+#include "CTRMode.h"
+
+// blocks hashed per GHASH reduction, and number of precomputed powers of H
+#define CTR_GCM_AGGREGATE 8
+
+// full length of a GCM tag in bytes
+#define CTR_GCM_TAG_SIZE 16
+
+// shortest tag CTRGcm_decrypt accepts unless short tags are allowed (SP 800-38D)
+#define CTR_GCM_MIN_TAG_SIZE 12
+
+// most data blocks of one message, the 32 bits counter must not come back to J0
+#define CTR_GCM_MAX_BLOCKS 0xfffffffeull
+
+/*
+	GCM on a 128 bits block cipher
+
+	Read only after CTRGcm_init, one CTRGcm can serve any number of
+	messages and threads. The key uses the 32 bits counter layout, GCM
+	only increments the last word of the counter block.
+*/
+typedef struct
+{
+	CTRKey key;
+	uint64_t h[2];			// H = E(0) as big endian halves, for the portable GHASH
+	_Alignas(16) uint8_t hPowers[CTR_GCM_AGGREGATE][16];	// H^1 .. H^8 byte reversed, for PCLMULQDQ
+	int clmul;				// PCLMULQDQ GHASH in use
+	int shortTags;			// 8 and 4 bytes tags accepted, see CTRGcm_allowShortTags
+} CTRGcm;
+
+int CTRGcm_init(CTRGcm* gcm, enum Algorithm algorithm, const uint32_t* key);
+void CTRGcm_allowShortTags(CTRGcm* gcm);
+int CTRGcm_encrypt(const CTRGcm* gcm, const uint8_t* iv, size_t ivLength, const uint8_t* aad, size_t aadLength,
+	const uint8_t* in, uint8_t* out, size_t length, uint8_t* tag);
+int CTRGcm_decrypt(const CTRGcm* gcm, const uint8_t* iv, size_t ivLength, const uint8_t* aad, size_t aadLength,
+	const uint8_t* in, uint8_t* out, size_t length, const uint8_t* tag, size_t tagLength);
+void CTRGcm_final(CTRGcm* gcm);
@@ -0,0 +1,256 @@
+/* CTRJobManager.c
+*
+ * Author: Nicolas Moura
+ * Created: 18/10/2026
+ *
+ * Submit / flush multi-buffer manager for CTR jobs of one algorithm
+ * under any number of keys. submit only queues a job until every lane
+ * is busy; then the lanes run until at least one job completes, and
+ * completed jobs are handed back one per submit or flush call.
+ *
+ */
+
+#include "CTRJobManager.h"
+
+static void pushCompleted(CTRJobManager* manager, CTRJob* job)
+{
+	int tail = (manager->completedHead + manager->nrCompleted) % (2 * CTR_MAX_LANES);
+
+	manager->completed[tail] = job;
+	manager->nrCompleted++;
+}
+
+static CTRJob* popCompleted(CTRJobManager* manager)
+{
+	CTRJob* job;
+
+	if (manager->nrCompleted == 0)
+	{
+		return NULL;
+	}
+
+	job = manager->completed[manager->completedHead];
+	manager->completedHead = (manager->completedHead + 1) % (2 * CTR_MAX_LANES);
+	manager->nrCompleted--;
+	return job;
+}
+
+// Blocks the job still needs, the last one may be partial
+static size_t blocksLeft(const CTRJobManager* manager, const CTRJob* job)
+{
+	return (job->length - job->offset + manager->blockBytes - 1) / manager->blockBytes;
+}
+
+/*
+	Advances every busy lane by the same number of blocks until the
+	shortest job is done. With a lane kernel the key stream of step g for
+	lane l is block g * nrLanes + l, otherwise each lane gets a contiguous
+	run encrypted by the cipher's multi-block kernel.
+*/
+static void runLanes(CTRJobManager* manager)
+{
+	uint8_t counters[CTR_BATCH_BLOCKS * CTR_MAX_LANES * 16];
+	uint8_t keyStream[CTR_BATCH_BLOCKS * CTR_MAX_LANES * 16];
+	int bytes = manager->blockBytes;
+	int done = 0;
+	size_t steps;
+	size_t n;
+	int lane;
+
+	while (!done)
+	{
+		steps = CTR_BATCH_BLOCKS;
+		for (lane = 0; lane < manager->nrLanes; lane++)
+		{
+			if (manager->jobs[lane] != NULL && blocksLeft(manager, manager->jobs[lane]) < steps)
+			{
+				steps = blocksLeft(manager, manager->jobs[lane]);
+			}
+		}
+
+		if (manager->encryptLanes != NULL)
+		{
+			for (lane = 0; lane < manager->nrLanes; lane++)
+			{
+				CTRJob* job = manager->jobs[lane];
+
+				for (size_t g = 0; g < steps; g++)
+				{
+					uint8_t* block = counters + (g * manager->nrLanes + lane) * bytes;
+
+					if (job != NULL)
+					{
+						CTRMode_counterBlocks(job->ctrNonce, manager->blockWords, job->key->counterWords, block, 1);
+					}
+					else
+					{
+						// idle lane, its output is ignored
+						memset(block, 0, bytes);
+					}
+				}
+			}
+
+			manager->encryptLanes(manager->lanes, counters, keyStream, steps);
+		}
+		else
+		{
+			for (lane = 0; lane < manager->nrLanes; lane++)
+			{
+				CTRJob* job = manager->jobs[lane];
+
+				if (job != NULL)
+				{
+					CTRMode_counterBlocks(job->ctrNonce, manager->blockWords, job->key->counterWords, counters + lane * steps * bytes, steps);
+					job->key->encryptBlocks(job->key->keySchedule, counters + lane * steps * bytes,
+						keyStream + lane * steps * bytes, steps);
+				}
+			}
+		}
+
+		for (lane = 0; lane < manager->nrLanes; lane++)
+		{
+			CTRJob* job = manager->jobs[lane];
+
+			if (job == NULL)
+			{
+				continue;
+			}
+
+			for (size_t g = 0; g < steps; g++)
+			{
+				size_t index = (manager->encryptLanes != NULL) ? g * manager->nrLanes + lane : lane * steps + g;
+
+				n = job->length - job->offset;
+				if (n > (size_t)bytes)
+				{
+					n = bytes;
+				}
+
+				CTRMode_xorKeyStream(job->in + job->offset, keyStream + index * bytes, job->out + job->offset, n);
+				job->offset += n;
+			}
+
+			if (job->offset == job->length)
+			{
+				job->status = 0;
+				manager->jobs[lane] = NULL;
+				manager->active--;
+				pushCompleted(manager, job);
+				done = 1;
+			}
+		}
+	}
+}
+
+int CTRJobManager_init(CTRJobManager* manager, enum Algorithm algorithm)
+{
+	manager->cipher = CipherRegistry_lookup(algorithm, &manager->keySize);
+	if (manager->cipher == NULL)
+	{
+		return -1;
+	}
+
+	manager->blockWords = manager->cipher->blockSize / 32;
+	manager->blockBytes = manager->cipher->blockSize / 8;
+	manager->active = 0;
+	manager->completedHead = 0;
+	manager->nrCompleted = 0;
+	manager->lanes = NULL;
+
+	manager->encryptLanes = CipherRegistry_encryptLanes(manager->cipher);
+	if (manager->encryptLanes != NULL && manager->cipher->nrLanes <= CTR_MAX_LANES)
+	{
+		size_t size = (manager->cipher->lanesSize + CTR_CACHE_LINE - 1) / CTR_CACHE_LINE * CTR_CACHE_LINE;
+
+		manager->lanes = aligned_alloc(CTR_CACHE_LINE, size);
+	}
+
+	if (manager->lanes != NULL)
+	{
+		manager->nrLanes = manager->cipher->nrLanes;
+	}
+	else
+	{
+		manager->encryptLanes = NULL;
+		manager->nrLanes = CTR_SCALAR_LANES;
+	}
+
+	for (int lane = 0; lane < CTR_MAX_LANES; lane++)
+	{
+		manager->jobs[lane] = NULL;
+	}
+
+	return 0;
+}
+
+/*
+	Queues job and returns a completed job, or NULL when none is ready
+	yet. The returned job may be an earlier one.
+*/
+CTRJob* CTRJobManager_submit(CTRJobManager* manager, CTRJob* job)
+{
+	int lane;
+
+	job->offset = 0;
+
+	if (job->key->cipher != manager->cipher || job->key->keySize != manager->keySize)
+	{
+		job->status = -1;
+		pushCompleted(manager, job);
+		return popCompleted(manager);
+	}
+
+	if (job->length == 0)
+	{
+		job->status = 0;
+		pushCompleted(manager, job);
+		return popCompleted(manager);
+	}
+
+	for (lane = 0; manager->jobs[lane] != NULL; lane++)
+	{
+	}
+
+	for (int i = 0; i < 4; i++)
+	{
+		job->ctrNonce[i] = (i < manager->blockWords) ? job->nonce[i] : 0;
+	}
+
+	if (manager->encryptLanes != NULL)
+	{
+		manager->cipher->loadLane(manager->lanes, lane, job->key->keySchedule);
+	}
+
+	manager->jobs[lane] = job;
+	manager->active++;
+
+	if (manager->active == manager->nrLanes)
+	{
+		runLanes(manager);
+	}
+
+	return popCompleted(manager);
+}
+
+// Returns the next completed job, running partially filled lanes if needed; NULL when nothing is left
+CTRJob* CTRJobManager_flush(CTRJobManager* manager)
+{
+	if (manager->nrCompleted == 0 && manager->active > 0)
+	{
+		runLanes(manager);
+	}
+
+	return popCompleted(manager);
+}
+
+void CTRJobManager_final(CTRJobManager* manager)
+{
+	if (manager->lanes != NULL)
+	{
+		// the lanes hold round keys, wipe them before releasing them
+		CTRMode_wipe(manager->lanes, manager->cipher->lanesSize);
+
+		free(manager->lanes);
+		manager->lanes = NULL;
+	}
+}
@@ -0,0 +1,67 @@
+/* CTRJobManager.h
+*
+ * Author: Nicolas Moura
+ * Created: 18/10/2026
+ *
+ * Submit / flush multi-buffer CTR job manager.
+ *
+ */
+
+#pragma once
+
+#include "CTRMode.h"
+
+// most lanes of a job manager, and lanes used when the cipher has no lane kernel
+#define CTR_MAX_LANES 8
+
+#define CTR_SCALAR_LANES 4
+
+// Job of a CTRJobManager; the caller fills the first fields and keeps the job alive until it is returned
+typedef struct
+{
+	const CTRKey* key;		// any key of the manager's algorithm
+	const uint32_t* nonce;
+	const uint8_t* in;
+	uint8_t* out;
+	size_t length;			// in bytes
+	void* userData;			// not used by the manager
+	int status;				// 0 when done, -1 when key is not of the manager's algorithm
+
+	// progress, owned by the manager
+	uint32_t ctrNonce[4];
+	size_t offset;
+} CTRJob;
+
+/*
+	Multi-buffer job manager
+
+	Jobs with different keys, nonces and lengths of one algorithm are
+	spread over lanes. Once every lane holds a job all lanes advance
+	together, one block each per step, until the shortest job completes;
+	its lane is then free for the next submitted job, so uneven lengths
+	do not leave lanes idle. Ciphers with a lane kernel (SPECK, SIMON)
+	encrypt the blocks of all lanes with one SIMD call, the others run
+	their multi-block kernel lane by lane.
+*/
+typedef struct
+{
+	const CipherDescriptor* cipher;
+	int keySize;
+	int blockWords;
+	int blockBytes;
+	CipherEncryptLanes encryptLanes;	// NULL for the scalar lanes
+	void* lanes;						// lane layout of the cipher when encryptLanes is used
+	int nrLanes;
+	int active;
+	CTRJob* jobs[CTR_MAX_LANES];		// job of each lane, NULL when free
+
+	// completed jobs not returned yet, FIFO
+	CTRJob* completed[2 * CTR_MAX_LANES];
+	int completedHead;
+	int nrCompleted;
+} CTRJobManager;
+
+int CTRJobManager_init(CTRJobManager* manager, enum Algorithm algorithm);
+CTRJob* CTRJobManager_submit(CTRJobManager* manager, CTRJob* job);
+CTRJob* CTRJobManager_flush(CTRJobManager* manager);
+void CTRJobManager_final(CTRJobManager* manager);
@@ -6,123 +6,508 @@
  */
 
 #include "CTRMode.h"
-#include "algorithms/ARIA/ARIA.h"
-#include "algorithms/CAMELLIA/CAMELLIA.h"
-#include "algorithms/NOEKEON/NOEKEON.h"
-#include "algorithms/SEED/SEED.h"
-#include "algorithms/SIMON/SIMON.h"
-#include "algorithms/SPECK/SPECK.h"
-#include "algorithms/IDEA/IDEA.h"
-#include "algorithms/PRESENT/PRESENT.h"
-#include "algorithms/HIGHT/HIGHT.h"
-#include "algorithms/GOST/GOST.h"
-
-void Select_Algorithm(CTRCounter* ctrCounter, enum Algorithm algorithm){
-	switch (algorithm)
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
+// Big endian increment of the counter field, carrying across its words only
+static void Increment_Counter(uint32_t* ctrNonce, int blockWords, int counterWords)
+{
+	for (int i = blockWords - 1; i >= blockWords - counterWords; i--)
+	{
+		if (++ctrNonce[i] != 0)
 		{
-		case ARIA_128 :
-			ARIA_main(ctrCounter, 128);
-			break;
-		case ARIA_192 :
-			ARIA_main(ctrCounter, 192);
-			break;
-		case ARIA_256 :
-			ARIA_main(ctrCounter, 256);
-			break;
-		case CAMELLIA_128 :
-			CAMELLIA_main(ctrCounter, 128);
-			break;
-		case CAMELLIA_192 :
-			CAMELLIA_main(ctrCounter, 192);
-			break;
-		case CAMELLIA_256 :
-			CAMELLIA_main(ctrCounter, 256);
-			break;
-		case NOEKEON_128 :
-			NOEKEON_main(ctrCounter, 128);
-			break;
-		case SEED_128 :
-			SEED_main(ctrCounter, 128);
-			break;
-		case SIMON_128 :
-			SIMON_main(ctrCounter, 128);
-			break;
-		case SIMON_192 :
-			SIMON_main(ctrCounter, 192);
 			break;
-		case SIMON_256 :
-			SIMON_main(ctrCounter, 256);
-			break;
-		case SPECK_128 :
-			SPECK_main(ctrCounter, 128);
-			break;
-		case SPECK_192 :
-			SPECK_main(ctrCounter, 192);
-			break;
-		case SPECK_256 :
-			SPECK_main(ctrCounter, 256);
-			break;
-		case IDEA_128 :
-			IDEA_main(ctrCounter, 128);
-			break;		
-		case PRESENT_80 :
-			PRESENT_main(ctrCounter, 80);
-			break;
-		case PRESENT_128 :
-			PRESENT_main(ctrCounter, 128);
-			break;
-		case HIGHT_128 :
-			HIGHT_main(ctrCounter, 128);
+		}
+	}
+}
+
+/*
+	64 bits blocks: the whole counter block is one native integer, so the
+	counter field is a mask and no carry has to be propagated by hand
+*/
+static void counterBlocks64(uint32_t* ctrNonce, int counterWords, uint8_t* blocks, size_t nrBlocks)
+{
+	uint64_t mask = (counterWords == 2) ? UINT64_MAX : UINT32_MAX;
+	uint64_t block = (uint64_t)ctrNonce[0] << 32 | ctrNonce[1];
+	uint64_t nonce = block & ~mask;
+	uint64_t counter = block & mask;
+
+	for (size_t i = 0; i < nrBlocks; i++)
+	{
+		STORE64_BE(blocks + 8 * i, nonce | ((counter + i) & mask));
+	}
+
+	block = nonce | ((counter + nrBlocks) & mask);
+	ctrNonce[0] = (uint32_t)(block >> 32);
+	ctrNonce[1] = (uint32_t)block;
+}
+
+/*
+	Writes nrBlocks consecutive counter blocks and advances ctrNonce past
+	them. Only the last counterWords words count, the words before them
+	are the fixed nonce and the counter wraps around inside its field.
+*/
+void CTRMode_counterBlocks(uint32_t* ctrNonce, int blockWords, int counterWords, uint8_t* blocks, size_t nrBlocks)
+{
+	int last = blockWords - 1;
+	size_t block;
+
+	if (blockWords == 2)
+	{
+		counterBlocks64(ctrNonce, counterWords, blocks, nrBlocks);
+		return;
+	}
+
+	if (nrBlocks <= (size_t)(UINT32_MAX - ctrNonce[last]))
+	{
+		// common case: no carry out of the lowest word inside the batch,
+		// so the blocks only differ in their last word
+		for (block = 0; block < nrBlocks; block++)
+		{
+			for (int i = 0; i < last; i++)
+			{
+				STORE32_BE(blocks + 4 * i, ctrNonce[i]);
+			}
+			STORE32_BE(blocks + 4 * last, ctrNonce[last] + (uint32_t)block);
+			blocks += 4 * blockWords;
+		}
+		ctrNonce[last] += (uint32_t)nrBlocks;
+		return;
+	}
+
+	for (block = 0; block < nrBlocks; block++)
+	{
+		for (int i = 0; i < blockWords; i++)
+		{
+			STORE32_BE(blocks + 4 * i, ctrNonce[i]);
+		}
+		Increment_Counter(ctrNonce, blockWords, counterWords);
+		blocks += 4 * blockWords;
+	}
+}
+
+// Adds nrBlocks to the big endian counter field, modulo the size of the field
+void CTRMode_addCounter(uint32_t* ctrNonce, int blockWords, int counterWords, uint64_t nrBlocks)
+{
+	uint64_t carry = nrBlocks;
+	uint64_t sum;
+
+	for (int i = blockWords - 1; i >= blockWords - counterWords && carry != 0; i--)
+	{
+		sum = (uint64_t)ctrNonce[i] + (uint32_t)carry;
+		ctrNonce[i] = (uint32_t)sum;
+		carry = (carry >> 32) + (sum >> 32);
+	}
+}
+
+/*
+	Expands the key schedule of algorithm. layout selects how much of the
+	counter block is incremented, the rest holding the nonce. With
+	keyWords NULL the schedule is only allocated, for a later
+	CTRKey_rekey.
+*/
+int CTRKey_initLayout(CTRKey* key, enum Algorithm algorithm, const uint32_t* keyWords, enum CTRCounterLayout layout)
+{
+	size_t align;
+	size_t size;
+	void* keySchedule;
+
+	key->algorithm = algorithm;
+	key->keySchedule = NULL;
+	key->cipher = CipherRegistry_lookup(algorithm, &key->keySize);
+	if (key->cipher == NULL)
+	{
+		return -1;
+	}
+
+	key->blockWords = key->cipher->blockSize / 32;
+	key->blockBytes = key->cipher->blockSize / 8;
+	key->batchBlocks = CTR_BATCH_BLOCKS * 16 / key->blockBytes;
+	key->layout = layout;
+	switch (layout)
+	{
+		case CTR_COUNTER_32:
+			key->counterWords = 1;
 			break;
-		case GOST_256 :
-			GOST_main(ctrCounter, 256);
+		case CTR_COUNTER_64:
+			key->counterWords = (key->blockWords < 2) ? key->blockWords : 2;
 			break;
 		default:
+			key->counterWords = key->blockWords;
 			break;
-		}
+	}
+	key->encryptBlocks = CipherRegistry_encryptBlocks(key->cipher);
+
+	// own cache lines, so the schedule never shares a line with written data
+	align = (key->cipher->contextAlign > CTR_CACHE_LINE) ? key->cipher->contextAlign : CTR_CACHE_LINE;
+	size = (key->cipher->contextSize + align - 1) / align * align;
+
+	keySchedule = aligned_alloc(align, size);
+	if (keySchedule == NULL)
+	{
+		return -1;
+	}
+
+	// the key schedule is expanded only once for the whole stream
+	if (keyWords != NULL)
+	{
+		key->cipher->init(keySchedule, keyWords, key->keySize);
+	}
+	key->keySchedule = keySchedule;
+
+	return 0;
+}
+
+int CTRKey_init(CTRKey* key, enum Algorithm algorithm, const uint32_t* keyWords)
+{
+	return CTRKey_initLayout(key, algorithm, keyWords, CTR_COUNTER_FULL);
+}
+
+/*
+	Expands keyWords into the schedule of key, which keeps its algorithm,
+	key size and layout. This is the only place a CTRKey changes after
+	CTRKey_init: the caller must make sure that no stream, thread or
+	copy of the key uses it during the call.
+*/
+void CTRKey_rekey(CTRKey* key, const uint32_t* keyWords)
+{
+	// the schedule is owned by key, allocated writable by CTRKey_initLayout
+	key->cipher->init((void*)key->keySchedule, keyWords, key->keySize);
 }
 
+void CTRKey_final(CTRKey* key)
+{
+	if (key->keySchedule != NULL)
+	{
+		// wipe the expanded key before releasing it
+		CTRMode_wipe((void*)key->keySchedule, key->cipher->contextSize);
 
+		free((void*)key->keySchedule);
+		key->keySchedule = NULL;
+	}
+}
 
-void CTRMode_main(CTRCounter ctrCounter, enum Algorithm algorithm, int SIZE){
+void CTRState_init(CTRState* state, const CTRKey* key, const uint32_t* nonce)
+{
+	state->key = key;
+	state->position = 0;
+	state->streamThreshold = CTR_STREAM_THRESHOLD;
 
-    // ENCRYPT SIDE	
-    Select_Algorithm(&ctrCounter, algorithm);
+	for (int i = 0; i < 4; i++)
+	{
+		state->nonce[i] = (i < key->blockWords) ? nonce[i] : 0;
+		state->ctrNonce[i] = state->nonce[i];
+	}
+}
+
+/*
+	Moves the stream to byte offset of the key stream: the counter becomes
+	nonce + offset / block size and the offset inside that block is kept
+	in position, with the block already encrypted so the next update
+	starts from its remaining bytes. Nothing before offset is generated.
+*/
+void CTRState_seek(CTRState* state, uint64_t offset)
+{
+	const CTRKey* key = state->key;
 
-	printf("\nCypher before XOR: \t");
 	for (int i = 0; i < 4; i++)
 	{
-		printf("%08x ", ctrCounter.cipherText[i]);
+		state->ctrNonce[i] = state->nonce[i];
 	}
+	CTRMode_addCounter(state->ctrNonce, key->blockWords, key->counterWords, offset / key->blockBytes);
 
-	ctrCounter.cipherTemp[0] = ctrCounter.text[0] ^ ctrCounter.cipherText[0];
-	ctrCounter.cipherTemp[1] = ctrCounter.text[1] ^ ctrCounter.cipherText[1];
-	if(SIZE == 4){
-		ctrCounter.cipherTemp[2] = ctrCounter.text[2] ^ ctrCounter.cipherText[2];
-		ctrCounter.cipherTemp[3] = ctrCounter.text[3] ^ ctrCounter.cipherText[3];
-	}else{
-		ctrCounter.cipherTemp[2] = 0x00000000;
-		ctrCounter.cipherTemp[3] = 0x00000000;
+	state->position = offset % key->blockBytes;
+	if (state->position != 0)
+	{
+		CTRState_keyStream(state, state->keyStream, 1);
 	}
+}
 
-	printf("\nCypher after XOR: \t");
-	for (int i = 0; i < 4; i++)
+void CTRState_keyStream(CTRState* state, uint8_t* keyStream, size_t nrBlocks)
+{
+	uint8_t counters[CTR_BATCH_BLOCKS * 16];
+	const CTRKey* key = state->key;
+
+	while (nrBlocks > 0)
+	{
+		size_t batch = (nrBlocks < (size_t)key->batchBlocks) ? nrBlocks : (size_t)key->batchBlocks;
+
+		// generate the whole batch of counter blocks before encrypting them
+		CTRMode_counterBlocks(state->ctrNonce, key->blockWords, key->counterWords, counters, batch);
+
+		key->encryptBlocks(key->keySchedule, counters, keyStream, batch);
+		keyStream += batch * key->blockBytes;
+
+		nrBlocks -= batch;
+	}
+}
+
+// XORs length bytes of in with keyStream, 64 bits at a time then byte per byte
+static void xorScalar(const uint8_t* in, const uint8_t* keyStream, uint8_t* out, size_t length)
+{
+	uint64_t x, k;
+	size_t i = 0;
+
+	for (; i + 8 <= length; i += 8)
+	{
+		memcpy(&x, in + i, 8);
+		memcpy(&k, keyStream + i, 8);
+		x ^= k;
+		memcpy(out + i, &x, 8);
+	}
+
+	for (; i < length; i++)
+	{
+		out[i] = in[i] ^ keyStream[i];
+	}
+}
+
+#ifdef __x86_64__
+
+// XOR of the whole 32 bytes words, returns the number of bytes done
+__attribute__((target("avx2")))
+static size_t xorAvx2(const uint8_t* in, const uint8_t* keyStream, uint8_t* out, size_t length, int nonTemporal)
+{
+	__m256i x, k;
+	size_t i = 0;
+
+	if (nonTemporal)
+	{
+		// out is 32 bytes aligned by the caller, the stores go straight to memory
+		for (; i + 32 <= length; i += 32)
+		{
+			x = _mm256_loadu_si256((const __m256i*)(in + i));
+			k = _mm256_loadu_si256((const __m256i*)(keyStream + i));
+			_mm256_stream_si256((__m256i*)(out + i), _mm256_xor_si256(x, k));
+		}
+		return i;
+	}
+
+	for (; i + 32 <= length; i += 32)
+	{
+		x = _mm256_loadu_si256((const __m256i*)(in + i));
+		k = _mm256_loadu_si256((const __m256i*)(keyStream + i));
+		_mm256_storeu_si256((__m256i*)(out + i), _mm256_xor_si256(x, k));
+	}
+	return i;
+}
+
+#endif
+
+// wide XOR kernel, in the form of xorAvx2
+typedef size_t (*CTRXorWide)(const uint8_t* in, const uint8_t* keyStream, uint8_t* out, size_t length, int nonTemporal);
+
+// the AVX2 XOR when the CPU has it, NULL otherwise
+static CTRXorWide xorWide;
+
+// picks the XOR kernels once at load time instead of on every call
+__attribute__((constructor))
+static void selectXorKernels(void)
+{
+#ifdef __x86_64__
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		xorWide = xorAvx2;
+	}
+#endif
+}
+
+/*
+	out = in ^ keyStream over length bytes, in and out may be the same
+	buffer. With nonTemporal the stores bypass the caches (AVX2 only) and
+	the caller issues the store fence once it is done.
+*/
+static void xorKeyStream(const uint8_t* in, const uint8_t* keyStream, uint8_t* out, size_t length, int nonTemporal)
+{
+	size_t i = 0;
+
+	if (length >= 32 && xorWide != NULL)
+	{
+		if (nonTemporal)
+		{
+			// streaming stores need an aligned destination
+			i = (size_t)(-(uintptr_t)out & 31);
+			xorScalar(in, keyStream, out, i);
+		}
+		i += xorWide(in + i, keyStream + i, out + i, length - i, nonTemporal);
+	}
+
+	xorScalar(in + i, keyStream + i, out + i, length - i);
+}
+
+void CTRMode_xorKeyStream(const uint8_t* in, const uint8_t* keyStream, uint8_t* out, size_t length)
+{
+	xorKeyStream(in, keyStream, out, length, 0);
+}
+
+// Zeroes length bytes of secret data, through volatile stores the compiler cannot drop
+void CTRMode_wipe(void* buffer, size_t length)
+{
+	volatile uint8_t* p = buffer;
+	for (size_t i = 0; i < length; i++)
+	{
+		p[i] = 0;
+	}
+}
+
+/*
+	Encrypts (or decrypts) length bytes. The bytes left in the current key
+	stream block are used first, then whole blocks in batches; a final
+	partial block is kept in the state for the next call. Any length is
+	accepted and in may be the same buffer as out.
+*/
+void CTRState_update(CTRState* state, const uint8_t* in, uint8_t* out, size_t length)
+{
+	uint8_t keyStream[CTR_BATCH_BLOCKS * 16];
+	int bytes = state->key->blockBytes;
+	int nonTemporal = (state->streamThreshold != 0 && length >= state->streamThreshold);
+	size_t nrBlocks;
+	size_t n;
+
+	if (state->position != 0)
+	{
+		n = bytes - state->position;
+		if (n > length)
+		{
+			n = length;
+		}
+
+		CTRMode_xorKeyStream(in, state->keyStream + state->position, out, n);
+		state->position = (state->position + n) % bytes;
+
+		in += n;
+		out += n;
+		length -= n;
+	}
+
+	nrBlocks = length / bytes;
+	while (nrBlocks > 0)
 	{
-		printf("%08x ", ctrCounter.cipherTemp[i]);
-	}
-	
-	// DECRYPT SIDE
-	Select_Algorithm(&ctrCounter, algorithm);
-	
-	ctrCounter.cipherText[0] = ctrCounter.cipherTemp[0] ^ ctrCounter.cipherText[0];
-	ctrCounter.cipherText[1] = ctrCounter.cipherTemp[1] ^ ctrCounter.cipherText[1];
-	ctrCounter.cipherText[2] = ctrCounter.cipherTemp[2] ^ ctrCounter.cipherText[2];
-	ctrCounter.cipherText[3] = ctrCounter.cipherTemp[3] ^ ctrCounter.cipherText[3];
-	
-	printf("\nDecrypt: \t\t");
+		size_t batch = (nrBlocks < (size_t)state->key->batchBlocks) ? nrBlocks : (size_t)state->key->batchBlocks;
+		size_t batchBytes = batch * bytes;
+
+		// the batch of key stream is still in L1 when it is XORed
+		CTRState_keyStream(state, keyStream, batch);
+		xorKeyStream(in, keyStream, out, batchBytes, nonTemporal);
+
+		in += batchBytes;
+		out += batchBytes;
+		nrBlocks -= batch;
+	}
+
+#ifdef __x86_64__
+	if (nonTemporal)
+	{
+		// order the streaming stores before any later store of this thread
+		_mm_sfence();
+	}
+#endif
+
+	n = length % bytes;
+	if (n != 0)
+	{
+		CTRState_keyStream(state, state->keyStream, 1);
+		CTRMode_xorKeyStream(in, state->keyStream, out, n);
+		state->position = n;
+	}
+}
+
+/*
+	Scatter-gather update: the bytes of the in fragments, taken in order,
+	are encrypted into the out fragments. The two lists may be cut at
+	different places; the key stream continues across every boundary and
+	each contiguous piece goes through CTRState_update with its
+	multi-block kernels. Returns the number of bytes processed, the
+	smaller of the two total lengths.
+*/
+size_t CTRState_updatev(CTRState* state, const struct iovec* in, int inCount, const struct iovec* out, int outCount)
+{
+	size_t inOffset = 0;
+	size_t outOffset = 0;
+	size_t total = 0;
+	size_t n;
+	int i = 0;
+	int o = 0;
+
+	while (i < inCount && o < outCount)
+	{
+		n = in[i].iov_len - inOffset;
+		if (n > out[o].iov_len - outOffset)
+		{
+			n = out[o].iov_len - outOffset;
+		}
+
+		CTRState_update(state, (const uint8_t*)in[i].iov_base + inOffset, (uint8_t*)out[o].iov_base + outOffset, n);
+		total += n;
+		inOffset += n;
+		outOffset += n;
+
+		if (inOffset == in[i].iov_len)
+		{
+			i++;
+			inOffset = 0;
+		}
+		if (outOffset == out[o].iov_len)
+		{
+			o++;
+			outOffset = 0;
+		}
+	}
+
+	return total;
+}
+
+int CTRMode_initLayout(CTRContext* context, enum Algorithm algorithm, const uint32_t* key, const uint32_t* nonce, enum CTRCounterLayout layout)
+{
+	if (CTRKey_initLayout(&context->key, algorithm, key, layout) != 0)
+	{
+		return -1;
+	}
+
+	CTRState_init(&context->state, &context->key, nonce);
+	return 0;
+}
+
+int CTRMode_init(CTRContext* context, enum Algorithm algorithm, const uint32_t* key, const uint32_t* nonce)
+{
+	return CTRMode_initLayout(context, algorithm, key, nonce, CTR_COUNTER_FULL);
+}
+
+void CTRMode_keyStream(CTRContext* context, uint8_t* keyStream, size_t nrBlocks)
+{
+	CTRState_keyStream(&context->state, keyStream, nrBlocks);
+}
+
+void CTRMode_update(CTRContext* context, const uint8_t* in, uint8_t* out, size_t length)
+{
+	CTRState_update(&context->state, in, out, length);
+}
+
+void CTRMode_seek(CTRContext* context, uint64_t offset)
+{
+	CTRState_seek(&context->state, offset);
+}
+
+size_t CTRMode_updatev(CTRContext* context, const struct iovec* in, int inCount, const struct iovec* out, int outCount)
+{
+	return CTRState_updatev(&context->state, in, inCount, out, outCount);
+}
+
+void CTRMode_final(CTRContext* context)
+{
+	CTRKey_final(&context->key);
+
 	for (int i = 0; i < 4; i++)
 	{
-		printf("%08x ", ctrCounter.cipherText[i]);
-	}		
-	printf("\n\n");
+		context->state.nonce[i] = 0;
+		context->state.ctrNonce[i] = 0;
+	}
+	for (int i = 0; i < 16; i++)
+	{
+		context->state.keyStream[i] = 0;
+	}
+	context->state.position = 0;
 }
@@ -8,17 +8,10 @@
 #pragma once
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdint.h>
-
-typedef struct
-{
-	uint32_t ctrNonce[4]; 	// to 128 bits block lenth 
-	uint32_t text[4];
-	uint32_t cipherText[4];
-	uint32_t cipherTemp[4];
-	uint32_t Key[8];
-	uint8_t position;	
-} CTRCounter;
+#include <sys/uio.h>
+#include "CipherDescriptor.h"
 
 typedef struct
 {
@@ -29,8 +22,103 @@ typedef struct
 enum Algorithm {ARIA_128, ARIA_192, ARIA_256, CAMELLIA_128, CAMELLIA_192, CAMELLIA_256, NOEKEON_128, SEED_128, SIMON_128, SIMON_192, SIMON_256,
 SPECK_128, SPECK_192, SPECK_256, GOST_256, IDEA_128, PRESENT_80, PRESENT_128, HIGHT_128 };
 
+// number of 128 bits counter blocks generated and encrypted together (twice as many 64 bits ones)
+#define CTR_BATCH_BLOCKS 16
+
+// blocks of the largest batch, the one of the 64 bits ciphers
+#define CTR_MAX_BATCH_BLOCKS (CTR_BATCH_BLOCKS * 16 / 8)
+
+/*
+	Split of the counter block between the fixed nonce (leading words) and
+	the incremented counter (trailing words)
+
+	CTR_COUNTER_FULL	whole block is the counter, carries reach every word
+	CTR_COUNTER_32		96 bits nonce / 32 bits counter (RFC 3686), 32 / 32 for 64 bits blocks
+	CTR_COUNTER_64		64 bits nonce / 64 bits counter, for 64 bits blocks the same as FULL
+*/
+enum CTRCounterLayout { CTR_COUNTER_FULL, CTR_COUNTER_32, CTR_COUNTER_64 };
+
+/*
+	Default CTRState streamThreshold: outputs this large would evict the
+	key schedule and cipher tables from the caches, so they are written
+	with non-temporal stores instead
+*/
+#define CTR_STREAM_THRESHOLD (4u << 20)
+
+// key schedules are allocated on their own cache lines
+#define CTR_CACHE_LINE 64
+
+/*
+	Expanded key, immutable after CTRKey_init
+
+	It only holds read only data, so a single CTRKey can be shared by any
+	number of streams and threads. The only exception is CTRKey_rekey,
+	which its owner calls while no one else uses the key.
+*/
+typedef struct
+{
+	_Alignas(CTR_CACHE_LINE) CipherEncryptBlocks encryptBlocks;	// kernel used on the hot path
+	const void* keySchedule;		// cipher specific context (AriaContext, SpeckContext, ...)
+	const CipherDescriptor* cipher;	// resolved once by CTRKey_init
+	enum Algorithm algorithm;
+	int keySize;					// in bits
+	int blockWords;					// 2 for 64 bits block ciphers, 4 for 128 bits
+	int blockBytes;					// 8 for 64 bits block ciphers, 16 for 128 bits
+	int batchBlocks;				// blocks per key stream batch, twice as many for 64 bits blocks
+	enum CTRCounterLayout layout;
+	int counterWords;				// trailing words of the block incremented by the counter
+} CTRKey;
+
+// Per stream state: only the counter and the position inside the current block
+typedef struct
+{
+	const CTRKey* key;
+	uint32_t nonce[4];		// counter block of byte offset 0, used by CTRState_seek
+	uint32_t ctrNonce[4];	// next counter block (nonce || counter, big endian)
+	uint8_t keyStream[16];	// key stream of the current block when position != 0
+	uint8_t position;		// bytes already used from the current key stream block
+	size_t streamThreshold;	// updates of at least this many bytes bypass the cache, 0 never
+} CTRState;
+
+/*
+	Streaming CTR context owning its key
+
+	The key schedule is expanded once by CTRMode_init and reused for every
+	block of the stream until CTRMode_final wipes and releases it.
+*/
+typedef struct
+{
+	CTRKey key;
+	CTRState state;
+} CTRContext;
+
 //void ARIA_init(AriaContext* context, const uint32_t* key, uint32_t keyLength);
 //void ARIA_encrypt(AriaContext* context, uint32_t* block, uint32_t* P);
 //void ARIA_decrypt(AriaContext* context, uint32_t* block, uint32_t* P);
 
-void CTRMode_main(CTRCounter ctrCounter, enum Algorithm algorithm, int SIZE);
+const CipherDescriptor* CipherRegistry_lookup(enum Algorithm algorithm, int* keySize);
+CipherEncryptBlocks CipherRegistry_encryptBlocks(const CipherDescriptor* cipher);
+CipherEncryptLanes CipherRegistry_encryptLanes(const CipherDescriptor* cipher);
+
+int CTRKey_init(CTRKey* key, enum Algorithm algorithm, const uint32_t* keyWords);
+int CTRKey_initLayout(CTRKey* key, enum Algorithm algorithm, const uint32_t* keyWords, enum CTRCounterLayout layout);
+void CTRKey_rekey(CTRKey* key, const uint32_t* keyWords);
+void CTRKey_final(CTRKey* key);
+
+void CTRState_init(CTRState* state, const CTRKey* key, const uint32_t* nonce);
+void CTRState_update(CTRState* state, const uint8_t* in, uint8_t* out, size_t length);
+void CTRState_seek(CTRState* state, uint64_t offset);
+size_t CTRState_updatev(CTRState* state, const struct iovec* in, int inCount, const struct iovec* out, int outCount);
+void CTRState_keyStream(CTRState* state, uint8_t* keyStream, size_t nrBlocks);
+
+int CTRMode_init(CTRContext* context, enum Algorithm algorithm, const uint32_t* key, const uint32_t* nonce);
+int CTRMode_initLayout(CTRContext* context, enum Algorithm algorithm, const uint32_t* key, const uint32_t* nonce, enum CTRCounterLayout layout);
+void CTRMode_update(CTRContext* context, const uint8_t* in, uint8_t* out, size_t length);
+void CTRMode_seek(CTRContext* context, uint64_t offset);
+size_t CTRMode_updatev(CTRContext* context, const struct iovec* in, int inCount, const struct iovec* out, int outCount);
+void CTRMode_keyStream(CTRContext* context, uint8_t* keyStream, size_t nrBlocks);
+void CTRMode_counterBlocks(uint32_t* ctrNonce, int blockWords, int counterWords, uint8_t* blocks, size_t nrBlocks);
+void CTRMode_addCounter(uint32_t* ctrNonce, int blockWords, int counterWords, uint64_t nrBlocks);
+void CTRMode_xorKeyStream(const uint8_t* in, const uint8_t* keyStream, uint8_t* out, size_t length);
+void CTRMode_wipe(void* buffer, size_t length);
+void CTRMode_final(CTRContext* context);
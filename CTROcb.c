@@ -0,0 +1,310 @@
+/* CTROcb.c
+*
+ * Author: Nicolas Moura
+ * Created: 18/10/2026
+ *
+ * OCB (RFC 7253, 128 bits tags) on the 128 bits ciphers of the library.
+ * Every block is one cipher call between two XORs with its offset, and
+ * the offsets only depend on the block index through the L table, so a
+ * batch of offsets is computed first and the whole batch goes through
+ * the multi-block kernel of the cipher in a single call. There is no
+ * GF(2^128) multiplication, only doublings done once in CTROcb_init.
+ *
+ */
+
+#include "CTROcb.h"
+
+// out = a ^ b on 16 bytes
+static void xorBlock(uint8_t* out, const uint8_t* a, const uint8_t* b)
+{
+	uint64_t x[2];
+	uint64_t y[2];
+
+	memcpy(x, a, 16);
+	memcpy(y, b, 16);
+	x[0] ^= y[0];
+	x[1] ^= y[1];
+	memcpy(out, x, 16);
+}
+
+// out = 2 * in in GF(2^128)
+static void doubleBlock(uint8_t* out, const uint8_t* in)
+{
+	uint64_t hi = LOAD64_BE(in);
+	uint64_t lo = LOAD64_BE(in + 8);
+	uint64_t carry = (hi >> 63) * 0x87;
+
+	STORE64_BE(out, (hi << 1) | (lo >> 63));
+	STORE64_BE(out + 8, (lo << 1) ^ carry);
+}
+
+// Offset_0 of the nonce: Stretch = Ktop || (Ktop[1..64] ^ Ktop[9..72]) shifted left by bottom bits
+static void initialOffset(const CTROcb* ocb, const uint8_t* nonce, size_t nonceLength, uint8_t* offset)
+{
+	uint8_t block[16] = { 0 };
+	uint8_t stretch[24];
+	int bottom;
+	int shift;
+
+	// num2str(TAGLEN mod 128, 7) is 0 for 128 bits tags
+	memcpy(block + 16 - nonceLength, nonce, nonceLength);
+	block[15 - nonceLength] |= 0x01;
+
+	bottom = block[15] & 0x3f;
+	block[15] &= 0xc0;
+
+	ocb->key.encryptBlocks(ocb->key.keySchedule, block, stretch, 1);
+	for (int i = 0; i < 8; i++)
+	{
+		stretch[16 + i] = stretch[i] ^ stretch[i + 1];
+	}
+
+	shift = bottom % 8;
+	for (int i = 0; i < 16; i++)
+	{
+		offset[i] = stretch[i + bottom / 8] << shift;
+		if (shift != 0)
+		{
+			offset[i] |= stretch[i + bottom / 8 + 1] >> (8 - shift);
+		}
+	}
+
+	CTRMode_wipe(stretch, sizeof(stretch));
+}
+
+/*
+	Advances offset over n blocks, the first having index first (from 1),
+	and stores the offset of every block in offsets
+*/
+static void nextOffsets(const CTROcb* ocb, uint8_t* offset, uint64_t first, uint8_t* offsets, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		xorBlock(offset, offset, ocb->l[__builtin_ctzll(first + i)]);
+		memcpy(offsets + 16 * i, offset, 16);
+	}
+}
+
+// checksum ^= every block of blocks
+static void addChecksum(uint8_t* checksum, const uint8_t* blocks, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		xorBlock(checksum, checksum, blocks + 16 * i);
+	}
+}
+
+// HASH(K, A) of RFC 7253 into sum
+static void hashAad(const CTROcb* ocb, const uint8_t* aad, size_t aadLength, uint8_t* sum)
+{
+	uint8_t offsets[CTR_BATCH_BLOCKS * 16];
+	uint8_t buffer[CTR_BATCH_BLOCKS * 16];
+	uint8_t offset[16] = { 0 };
+	uint64_t index = 1;
+	size_t full = aadLength / 16;
+	size_t n;
+
+	memset(sum, 0, 16);
+
+	while (full > 0)
+	{
+		n = (full < CTR_BATCH_BLOCKS) ? full : CTR_BATCH_BLOCKS;
+
+		nextOffsets(ocb, offset, index, offsets, n);
+		for (size_t i = 0; i < n; i++)
+		{
+			xorBlock(buffer + 16 * i, aad + 16 * i, offsets + 16 * i);
+		}
+		ocb->key.encryptBlocks(ocb->key.keySchedule, buffer, buffer, n);
+		addChecksum(sum, buffer, n);
+
+		aad += 16 * n;
+		index += n;
+		full -= n;
+	}
+
+	if (aadLength % 16 != 0)
+	{
+		memset(buffer, 0, 16);
+		memcpy(buffer, aad, aadLength % 16);
+		buffer[aadLength % 16] = 0x80;
+
+		xorBlock(offset, offset, ocb->lStar);
+		xorBlock(buffer, buffer, offset);
+		ocb->key.encryptBlocks(ocb->key.keySchedule, buffer, buffer, 1);
+		xorBlock(sum, sum, buffer);
+	}
+
+	CTRMode_wipe(buffer, sizeof(buffer));
+}
+
+// Encrypts (encrypt != 0) or decrypts in to out and writes the tag
+static void ocbCrypt(const CTROcb* ocb, const uint8_t* nonce, size_t nonceLength, const uint8_t* aad, size_t aadLength,
+	const uint8_t* in, uint8_t* out, size_t length, uint8_t* tag, int encrypt)
+{
+	CipherEncryptBlocks crypt = encrypt ? ocb->key.encryptBlocks : ocb->key.cipher->decryptBlocks;
+	uint8_t offsets[CTR_BATCH_BLOCKS * 16];
+	uint8_t buffer[CTR_BATCH_BLOCKS * 16];
+	uint8_t offset[16];
+	uint8_t checksum[16] = { 0 };
+	uint8_t sum[16];
+	uint64_t index = 1;
+	size_t full = length / 16;
+	size_t n;
+
+	initialOffset(ocb, nonce, nonceLength, offset);
+
+	while (full > 0)
+	{
+		n = (full < CTR_BATCH_BLOCKS) ? full : CTR_BATCH_BLOCKS;
+
+		// the checksum is over the plaintext, read it before out may overwrite it
+		if (encrypt)
+		{
+			addChecksum(checksum, in, n);
+		}
+
+		nextOffsets(ocb, offset, index, offsets, n);
+		for (size_t i = 0; i < n; i++)
+		{
+			xorBlock(buffer + 16 * i, in + 16 * i, offsets + 16 * i);
+		}
+		crypt(ocb->key.keySchedule, buffer, buffer, n);
+		for (size_t i = 0; i < n; i++)
+		{
+			xorBlock(out + 16 * i, buffer + 16 * i, offsets + 16 * i);
+		}
+
+		if (!encrypt)
+		{
+			addChecksum(checksum, out, n);
+		}
+
+		in += 16 * n;
+		out += 16 * n;
+		index += n;
+		full -= n;
+	}
+
+	if (length % 16 != 0)
+	{
+		size_t last = length % 16;
+
+		// Pad = E(Offset_*), the partial block is XORed with it in both directions
+		xorBlock(offset, offset, ocb->lStar);
+		ocb->key.encryptBlocks(ocb->key.keySchedule, offset, buffer, 1);
+
+		memset(buffer + 16, 0, 16);
+		for (size_t i = 0; i < last; i++)
+		{
+			uint8_t p = encrypt ? in[i] : (uint8_t)(in[i] ^ buffer[i]);
+
+			out[i] = in[i] ^ buffer[i];
+			buffer[16 + i] = p;
+		}
+		buffer[16 + last] = 0x80;
+		xorBlock(checksum, checksum, buffer + 16);
+	}
+
+	// Tag = E(Checksum ^ Offset ^ L_$) ^ HASH(K, A)
+	xorBlock(checksum, checksum, offset);
+	xorBlock(checksum, checksum, ocb->lDollar);
+	ocb->key.encryptBlocks(ocb->key.keySchedule, checksum, tag, 1);
+	hashAad(ocb, aad, aadLength, sum);
+	xorBlock(tag, tag, sum);
+
+	CTRMode_wipe(offsets, sizeof(offsets));
+	CTRMode_wipe(buffer, sizeof(buffer));
+	CTRMode_wipe(offset, sizeof(offset));
+	CTRMode_wipe(checksum, sizeof(checksum));
+}
+
+/*
+	Expands key, which must be of a 128 bits block cipher able to decrypt,
+	and precomputes L_*, L_$ and the L table
+*/
+int CTROcb_init(CTROcb* ocb, enum Algorithm algorithm, const uint32_t* key)
+{
+	uint8_t zero[16] = { 0 };
+
+	if (CTRKey_init(&ocb->key, algorithm, key) != 0)
+	{
+		return -1;
+	}
+
+	if (ocb->key.blockBytes != 16 || ocb->key.cipher->decryptBlocks == NULL)
+	{
+		CTRKey_final(&ocb->key);
+		return -1;
+	}
+
+	ocb->key.encryptBlocks(ocb->key.keySchedule, zero, ocb->lStar, 1);
+	doubleBlock(ocb->lDollar, ocb->lStar);
+	doubleBlock(ocb->l[0], ocb->lDollar);
+	for (int i = 1; i < CTR_OCB_L_TABLE; i++)
+	{
+		doubleBlock(ocb->l[i], ocb->l[i - 1]);
+	}
+
+	return 0;
+}
+
+/*
+	Encrypts length bytes of in to out (may be the same buffer) and writes
+	the 16 bytes tag. The nonce is 1 to CTR_OCB_NONCE_MAX bytes and must
+	never be reused under the same key. Returns -1 for other nonce lengths.
+*/
+int CTROcb_encrypt(const CTROcb* ocb, const uint8_t* nonce, size_t nonceLength, const uint8_t* aad, size_t aadLength,
+	const uint8_t* in, uint8_t* out, size_t length, uint8_t* tag)
+{
+	if (nonceLength == 0 || nonceLength > CTR_OCB_NONCE_MAX)
+	{
+		return -1;
+	}
+
+	ocbCrypt(ocb, nonce, nonceLength, aad, aadLength, in, out, length, tag, 1);
+	return 0;
+}
+
+/*
+	Decrypts in to out. Returns 0 when tag matches; otherwise -1, with out
+	wiped. The tag length is part of the OCB nonce formatting, so only
+	full 16 bytes tags are accepted.
+*/
+int CTROcb_decrypt(const CTROcb* ocb, const uint8_t* nonce, size_t nonceLength, const uint8_t* aad, size_t aadLength,
+	const uint8_t* in, uint8_t* out, size_t length, const uint8_t* tag)
+{
+	uint8_t expected[CTR_OCB_TAG_SIZE];
+	uint8_t diff = 0;
+
+	if (nonceLength == 0 || nonceLength > CTR_OCB_NONCE_MAX)
+	{
+		CTRMode_wipe(out, length);
+		return -1;
+	}
+
+	ocbCrypt(ocb, nonce, nonceLength, aad, aadLength, in, out, length, expected, 0);
+
+	// constant time comparison
+	for (int i = 0; i < CTR_OCB_TAG_SIZE; i++)
+	{
+		diff |= expected[i] ^ tag[i];
+	}
+	CTRMode_wipe(expected, sizeof(expected));
+
+	if (diff != 0)
+	{
+		CTRMode_wipe(out, length);
+		return -1;
+	}
+
+	return 0;
+}
+
+void CTROcb_final(CTROcb* ocb)
+{
+	CTRMode_wipe(ocb->lStar, sizeof(ocb->lStar));
+	CTRMode_wipe(ocb->lDollar, sizeof(ocb->lDollar));
+	CTRMode_wipe(ocb->l, sizeof(ocb->l));
+	CTRKey_final(&ocb->key);
+}
@@ -0,0 +1,43 @@
+/* CTROcb.h
+*
+ * Author: Nicolas Moura
+ * Created: 18/10/2026
+ *
+ * OCB authenticated encryption (RFC 7253) on a 128 bits block
+ * cipher.
+ *
+ */
+
+#pragma once
+
+#include "CTRMode.h"
+
+// longest CTROcb nonce in bytes (RFC 7253 nonces are shorter than the block)
+#define CTR_OCB_NONCE_MAX 15
+
+// bytes of a CTROcb tag
+#define CTR_OCB_TAG_SIZE 16
+
+// L_0 .. L_63, enough for the ntz of any 64 bits block index
+#define CTR_OCB_L_TABLE 64
+
+/*
+	OCB on a 128 bits block cipher that can also decrypt
+
+	Read only after CTROcb_init, one CTROcb can serve any number of
+	messages and threads.
+*/
+typedef struct
+{
+	CTRKey key;
+	uint8_t lStar[16];					// L_* = E(0)
+	uint8_t lDollar[16];				// L_$ = double(L_*)
+	uint8_t l[CTR_OCB_L_TABLE][16];		// L_0 = double(L_$), L_i = double(L_i-1)
+} CTROcb;
+
+int CTROcb_init(CTROcb* ocb, enum Algorithm algorithm, const uint32_t* key);
+int CTROcb_encrypt(const CTROcb* ocb, const uint8_t* nonce, size_t nonceLength, const uint8_t* aad, size_t aadLength,
+	const uint8_t* in, uint8_t* out, size_t length, uint8_t* tag);
+int CTROcb_decrypt(const CTROcb* ocb, const uint8_t* nonce, size_t nonceLength, const uint8_t* aad, size_t aadLength,
+	const uint8_t* in, uint8_t* out, size_t length, const uint8_t* tag);
+void CTROcb_final(CTROcb* ocb);
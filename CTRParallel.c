@@ -0,0 +1,231 @@
+/* CTRParallel.c
+*
+ * Author: Nicolas Moura
+ * Created: 18/10/2026
+ *
+ * Parallel CTR over large buffers. Every thread of the pool encrypts
+ * its own range of blocks with a private copy of the stream state whose
+ * counter is advanced to the first block of the range; all of them
+ * share the read only CTRKey.
+ *
+ */
+
+#include <unistd.h>
+#include "CTRParallel.h"
+
+// Encrypts the chunk of the current job assigned to index
+static void runChunk(CTRPool* pool, int index)
+{
+	CTRState chunkState = *(const CTRState*)pool->data;
+	size_t first = (size_t)index * pool->chunkBlocks;
+	size_t nrBlocks;
+
+	if (first >= pool->nrBlocks)
+	{
+		return;
+	}
+
+	nrBlocks = pool->nrBlocks - first;
+	if (nrBlocks > pool->chunkBlocks)
+	{
+		nrBlocks = pool->chunkBlocks;
+	}
+
+	CTRMode_addCounter(chunkState.ctrNonce, chunkState.key->blockWords, chunkState.key->counterWords, first);
+	first *= chunkState.key->blockBytes;
+
+	// the size of the whole job, not of the chunk, decides on streaming stores
+	if (chunkState.streamThreshold != 0 && pool->nrBlocks * chunkState.key->blockBytes >= chunkState.streamThreshold)
+	{
+		chunkState.streamThreshold = 1;
+	}
+
+	CTRState_update(&chunkState, pool->in + first, pool->out + first, nrBlocks * chunkState.key->blockBytes);
+}
+
+static void* workerMain(void* arg)
+{
+	CTRPoolWorker* worker = arg;
+	CTRPool* pool = worker->pool;
+	// workers are started before the first job, a job may be submitted before this thread runs
+	unsigned long seen = 0;
+
+	pthread_mutex_lock(&pool->lock);
+
+	for (;;)
+	{
+		while (pool->generation == seen && !pool->stop)
+		{
+			pthread_cond_wait(&pool->start, &pool->lock);
+		}
+
+		if (pool->stop)
+		{
+			break;
+		}
+
+		seen = pool->generation;
+		pthread_mutex_unlock(&pool->lock);
+
+		pool->job(pool, worker->index);
+
+		pthread_mutex_lock(&pool->lock);
+		if (--pool->pending == 0)
+		{
+			pthread_cond_signal(&pool->done);
+		}
+	}
+
+	pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+
+/*
+	Starts nrThreads - 1 workers, the calling thread being the last one.
+	nrThreads <= 0 uses one thread per online CPU.
+*/
+int CTRPool_init(CTRPool* pool, int nrThreads)
+{
+	int i;
+
+	if (nrThreads <= 0)
+	{
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		nrThreads = (cpus > 0) ? (int)cpus : 1;
+	}
+
+	pool->nrThreads = nrThreads;
+	pool->generation = 0;
+	pool->pending = 0;
+	pool->stop = 0;
+	pool->workers = NULL;
+
+	pthread_mutex_init(&pool->submit, NULL);
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->start, NULL);
+	pthread_cond_init(&pool->done, NULL);
+
+	if (nrThreads == 1)
+	{
+		return 0;
+	}
+
+	pool->workers = calloc(nrThreads - 1, sizeof(CTRPoolWorker));
+	if (pool->workers == NULL)
+	{
+		CTRPool_final(pool);
+		return -1;
+	}
+
+	for (i = 0; i < nrThreads - 1; i++)
+	{
+		pool->workers[i].pool = pool;
+		pool->workers[i].index = i + 1;
+
+		if (pthread_create(&pool->workers[i].thread, NULL, workerMain, &pool->workers[i]) != 0)
+		{
+			// keep the workers already running, the rest of the chunks go to fewer threads
+			break;
+		}
+	}
+	pool->nrThreads = i + 1;
+
+	return 0;
+}
+
+/*
+	Runs job on the chunks of nrBlocks blocks from in to out, chunkBlocks
+	blocks per thread, and returns once every chunk is done
+*/
+void CTRPool_run(CTRPool* pool, CTRPoolJob job, const void* data, const uint8_t* in, uint8_t* out, size_t nrBlocks, size_t chunkBlocks)
+{
+	pthread_mutex_lock(&pool->submit);
+
+	pthread_mutex_lock(&pool->lock);
+	pool->job = job;
+	pool->data = data;
+	pool->in = in;
+	pool->out = out;
+	pool->nrBlocks = nrBlocks;
+	pool->chunkBlocks = chunkBlocks;
+	pool->pending = pool->nrThreads - 1;
+	pool->generation++;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+
+	job(pool, 0);
+
+	pthread_mutex_lock(&pool->lock);
+	while (pool->pending > 0)
+	{
+		pthread_cond_wait(&pool->done, &pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	pthread_mutex_unlock(&pool->submit);
+}
+
+void CTRPool_update(CTRPool* pool, CTRState* state, const uint8_t* in, uint8_t* out, size_t length)
+{
+	int bytes = state->key->blockBytes;
+	size_t nrBlocks;
+	size_t chunkBlocks;
+	size_t lead;
+	size_t whole;
+
+	if (pool->nrThreads == 1 || length / bytes < CTR_PARALLEL_MIN_BLOCKS)
+	{
+		CTRState_update(state, in, out, length);
+		return;
+	}
+
+	// finish a partially used block first, the chunks start on block boundaries
+	lead = (state->position != 0) ? (size_t)(bytes - state->position) : 0;
+	CTRState_update(state, in, out, lead);
+	in += lead;
+	out += lead;
+	length -= lead;
+	nrBlocks = length / bytes;
+
+	// whole batches per chunk, so every thread keeps the batched key stream
+	chunkBlocks = (nrBlocks + pool->nrThreads - 1) / pool->nrThreads;
+	chunkBlocks = (chunkBlocks + state->key->batchBlocks - 1) / state->key->batchBlocks * state->key->batchBlocks;
+
+	CTRPool_run(pool, runChunk, state, in, out, nrBlocks, chunkBlocks);
+
+	// the stream continues after the last block, as in the serial path
+	CTRMode_addCounter(state->ctrNonce, state->key->blockWords, state->key->counterWords, nrBlocks);
+
+	// and the partial block at the end, if any
+	whole = nrBlocks * bytes;
+	CTRState_update(state, in + whole, out + whole, length - whole);
+}
+
+void CTRMode_updateParallel(CTRContext* context, CTRPool* pool, const uint8_t* in, uint8_t* out, size_t length)
+{
+	CTRPool_update(pool, &context->state, in, out, length);
+}
+
+void CTRPool_final(CTRPool* pool)
+{
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = 1;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+
+	if (pool->workers != NULL)
+	{
+		for (int i = 0; i < pool->nrThreads - 1; i++)
+		{
+			pthread_join(pool->workers[i].thread, NULL);
+		}
+
+		free(pool->workers);
+		pool->workers = NULL;
+	}
+
+	pthread_mutex_destroy(&pool->submit);
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->start);
+	pthread_cond_destroy(&pool->done);
+}
@@ -0,0 +1,67 @@
+/* CTRParallel.h
+*
+ * Author: Nicolas Moura
+ * Created: 18/10/2026
+ *
+ * Persistent worker pool running CTR over large buffers on
+ * several threads.
+ *
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include "CTRMode.h"
+
+// below this many blocks a parallel update runs on the calling thread only
+#define CTR_PARALLEL_MIN_BLOCKS 4096
+
+typedef struct CTRPool CTRPool;
+
+// Runs the chunk index of the current job of pool
+typedef void (*CTRPoolJob)(CTRPool* pool, int index);
+
+typedef struct
+{
+	CTRPool* pool;
+	pthread_t thread;
+	int index;						// chunk of each job handled by this worker
+} CTRPoolWorker;
+
+/*
+	Persistent worker pool for parallel CTR
+
+	The threads are created once by CTRPool_init and sleep between jobs.
+	A job splits the buffer into one counter aligned chunk per thread
+	(the calling thread takes chunk 0), every chunk derives its counter
+	from the stream counter, so the output is the same as the serial one.
+	Jobs are serialized, a pool can be shared by several streams. The
+	ECB and CBC decryption paths submit their own jobs through
+	CTRPool_run.
+*/
+struct CTRPool
+{
+	CTRPoolWorker* workers;
+	int nrThreads;					// workers + the calling thread
+	pthread_mutex_t submit;			// one job at a time
+	pthread_mutex_t lock;
+	pthread_cond_t start;
+	pthread_cond_t done;
+	unsigned long generation;		// incremented for every job
+	int pending;					// workers still running the current job
+	int stop;
+
+	// current job
+	CTRPoolJob job;
+	const void* data;				// job specific, the CTRState of a CTR job
+	const uint8_t* in;
+	uint8_t* out;
+	size_t nrBlocks;
+	size_t chunkBlocks;
+};
+
+int CTRPool_init(CTRPool* pool, int nrThreads);
+void CTRPool_run(CTRPool* pool, CTRPoolJob job, const void* data, const uint8_t* in, uint8_t* out, size_t nrBlocks, size_t chunkBlocks);
+void CTRPool_update(CTRPool* pool, CTRState* state, const uint8_t* in, uint8_t* out, size_t length);
+void CTRMode_updateParallel(CTRContext* context, CTRPool* pool, const uint8_t* in, uint8_t* out, size_t length);
+void CTRPool_final(CTRPool* pool);
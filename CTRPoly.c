@@ -0,0 +1,289 @@
+/* CTRPoly.c
+*
+ * Author: Nicolas Moura
+ * Created: 18/10/2026
+ *
+ * Authenticated encryption for the 64 bits block ciphers (GOST, IDEA,
+ * HIGHT, PRESENT), which cannot use GCM. Each key stream batch is
+ * encrypted and its ciphertext fed to Poly1305 while still in L1, so the
+ * data is read and written once. Poly1305 works on 44 bits limbs with
+ * 64 x 64 bits multiplications.
+ *
+ */
+
+#include "CTRPoly.h"
+
+#define POLY_BATCH (CTR_BATCH_BLOCKS * 16)
+#define POLY_MASK44 0xfffffffffffull
+#define POLY_MASK42 0x3ffffffffffull
+
+typedef unsigned __int128 uint128_t;
+
+// Poly1305 state: r and h in 44 / 44 / 42 bits limbs
+typedef struct
+{
+	uint64_t r[3];
+	uint64_t h[3];
+	uint64_t pad[2];
+} PolyState;
+
+static void polyInit(PolyState* state, const uint8_t* key)
+{
+	uint64_t t0 = LOAD64_LE(key);
+	uint64_t t1 = LOAD64_LE(key + 8);
+
+	// clamped r
+	state->r[0] = t0 & 0xffc0fffffffull;
+	state->r[1] = ((t0 >> 44) | (t1 << 20)) & 0xfffffc0ffffull;
+	state->r[2] = (t1 >> 24) & 0x00ffffffc0full;
+
+	state->h[0] = 0;
+	state->h[1] = 0;
+	state->h[2] = 0;
+
+	state->pad[0] = LOAD64_LE(key + 16);
+	state->pad[1] = LOAD64_LE(key + 24);
+}
+
+// h = (h + block + hibit) * r mod 2^130 - 5 for every 16 bytes block
+static void polyBlocks(PolyState* state, const uint8_t* data, size_t nrBlocks, uint64_t hibit)
+{
+	uint64_t r0 = state->r[0], r1 = state->r[1], r2 = state->r[2];
+	uint64_t s1 = r1 * (5 << 2), s2 = r2 * (5 << 2);
+	uint64_t h0 = state->h[0], h1 = state->h[1], h2 = state->h[2];
+	uint64_t t0, t1, c;
+	uint128_t d0, d1, d2;
+
+	for (; nrBlocks > 0; nrBlocks--, data += 16)
+	{
+		t0 = LOAD64_LE(data);
+		t1 = LOAD64_LE(data + 8);
+
+		h0 += t0 & POLY_MASK44;
+		h1 += ((t0 >> 44) | (t1 << 20)) & POLY_MASK44;
+		h2 += ((t1 >> 24) & POLY_MASK42) | hibit;
+
+		d0 = (uint128_t)h0 * r0 + (uint128_t)h1 * s2 + (uint128_t)h2 * s1;
+		d1 = (uint128_t)h0 * r1 + (uint128_t)h1 * r0 + (uint128_t)h2 * s2;
+		d2 = (uint128_t)h0 * r2 + (uint128_t)h1 * r1 + (uint128_t)h2 * r0;
+
+		// partial reduction, the limbs stay a few bits above their size
+		c = (uint64_t)(d0 >> 44);
+		h0 = (uint64_t)d0 & POLY_MASK44;
+		d1 += c;
+		c = (uint64_t)(d1 >> 44);
+		h1 = (uint64_t)d1 & POLY_MASK44;
+		d2 += c;
+		c = (uint64_t)(d2 >> 42);
+		h2 = (uint64_t)d2 & POLY_MASK42;
+		h0 += c * 5;
+		c = h0 >> 44;
+		h0 &= POLY_MASK44;
+		h1 += c;
+	}
+
+	state->h[0] = h0;
+	state->h[1] = h1;
+	state->h[2] = h2;
+}
+
+// Message blocks of length bytes, the last one padded with zeros as in RFC 8439 AEAD
+static void polyPadded(PolyState* state, const uint8_t* data, size_t length)
+{
+	uint8_t block[16] = { 0 };
+
+	polyBlocks(state, data, length / 16, 1ull << 40);
+
+	if (length % 16 != 0)
+	{
+		memcpy(block, data + length / 16 * 16, length % 16);
+		polyBlocks(state, block, 1, 1ull << 40);
+	}
+}
+
+// tag = (h mod 2^130 - 5) + pad mod 2^128
+static void polyFinish(PolyState* state, uint8_t* tag)
+{
+	uint64_t h0 = state->h[0], h1 = state->h[1], h2 = state->h[2];
+	uint64_t g0, g1, g2, c, mask;
+
+	// full carry
+	c = h1 >> 44;
+	h1 &= POLY_MASK44;
+	h2 += c;
+	c = h2 >> 42;
+	h2 &= POLY_MASK42;
+	h0 += c * 5;
+	c = h0 >> 44;
+	h0 &= POLY_MASK44;
+	h1 += c;
+	c = h1 >> 44;
+	h1 &= POLY_MASK44;
+	h2 += c;
+	c = h2 >> 42;
+	h2 &= POLY_MASK42;
+	h0 += c * 5;
+	c = h0 >> 44;
+	h0 &= POLY_MASK44;
+	h1 += c;
+
+	// g = h + 5 - 2^130, selected without branches when h >= 2^130 - 5
+	g0 = h0 + 5;
+	c = g0 >> 44;
+	g0 &= POLY_MASK44;
+	g1 = h1 + c;
+	c = g1 >> 44;
+	g1 &= POLY_MASK44;
+	g2 = h2 + c - (1ull << 42);
+
+	mask = (g2 >> 63) - 1;
+	h0 = (h0 & ~mask) | (g0 & mask);
+	h1 = (h1 & ~mask) | (g1 & mask);
+	h2 = (h2 & ~mask) | (g2 & mask);
+
+	h0 += state->pad[0] & POLY_MASK44;
+	c = h0 >> 44;
+	h0 &= POLY_MASK44;
+	h1 += (((state->pad[0] >> 44) | (state->pad[1] << 20)) & POLY_MASK44) + c;
+	c = h1 >> 44;
+	h1 &= POLY_MASK44;
+	h2 += ((state->pad[1] >> 24) & POLY_MASK42) + c;
+	h2 &= POLY_MASK42;
+
+	STORE64_LE(tag, h0 | (h1 << 44));
+	STORE64_LE(tag + 8, (h1 >> 20) | (h2 << 24));
+
+	CTRMode_wipe(state, sizeof(*state));
+}
+
+/*
+	Encrypts (encrypt != 0) or decrypts in to out and writes the tag. The
+	Poly1305 key is the key stream of counter blocks 0 to 3, the data
+	starts at counter 4.
+*/
+static void polyCrypt(const CTRPoly* poly, const uint8_t* nonce, const uint8_t* aad, size_t aadLength,
+	const uint8_t* in, uint8_t* out, size_t length, uint8_t* tag, int encrypt)
+{
+	uint8_t polyKey[32];
+	uint8_t lengths[16];
+	uint32_t counter[4] = { 0 };
+	PolyState mac;
+	CTRState state;
+	size_t total = length;
+	size_t n;
+
+	counter[0] = LOAD32_BE(nonce);
+	CTRState_init(&state, &poly->key, counter);
+	CTRState_keyStream(&state, polyKey, 32 / poly->key.blockBytes);
+	polyInit(&mac, polyKey);
+	CTRMode_wipe(polyKey, sizeof(polyKey));
+
+	polyPadded(&mac, aad, aadLength);
+
+	while (length > 0)
+	{
+		n = (length < POLY_BATCH) ? length : POLY_BATCH;
+
+		if (!encrypt)
+		{
+			polyPadded(&mac, in, n);
+		}
+		CTRState_update(&state, in, out, n);
+		if (encrypt)
+		{
+			polyPadded(&mac, out, n);
+		}
+
+		in += n;
+		out += n;
+		length -= n;
+	}
+
+	STORE64_LE(lengths, aadLength);
+	STORE64_LE(lengths + 8, total);
+	polyBlocks(&mac, lengths, 1, 1ull << 40);
+	polyFinish(&mac, tag);
+
+	CTRMode_wipe(&state, sizeof(state));
+}
+
+// Expands key, which must be of a 64 bits block cipher
+int CTRPoly_init(CTRPoly* poly, enum Algorithm algorithm, const uint32_t* key)
+{
+	if (CTRKey_initLayout(&poly->key, algorithm, key, CTR_COUNTER_32) != 0)
+	{
+		return -1;
+	}
+
+	if (poly->key.blockBytes != 8)
+	{
+		CTRKey_final(&poly->key);
+		return -1;
+	}
+
+	return 0;
+}
+
+// The data fits between the Poly1305 key blocks and the wrap of the 32 bits counter
+static int validLength(const CTRPoly* poly, size_t length)
+{
+	return (uint64_t)((length + poly->key.blockBytes - 1) / poly->key.blockBytes) <= CTR_POLY_MAX_BLOCKS;
+}
+
+/*
+	Encrypts length bytes of in to out (may be the same buffer) and writes
+	the 16 bytes tag. nonce holds CTR_POLY_NONCE_SIZE bytes and must never
+	be reused under the same key: use a counter, not random values.
+	Returns -1, without encrypting, for more than CTR_POLY_MAX_BLOCKS
+	blocks of data.
+*/
+int CTRPoly_encrypt(const CTRPoly* poly, const uint8_t* nonce, const uint8_t* aad, size_t aadLength,
+	const uint8_t* in, uint8_t* out, size_t length, uint8_t* tag)
+{
+	if (!validLength(poly, length))
+	{
+		return -1;
+	}
+
+	polyCrypt(poly, nonce, aad, aadLength, in, out, length, tag, 1);
+	return 0;
+}
+
+/*
+	Decrypts in to out. Returns 0 when tag matches; otherwise -1, with out
+	wiped, which is also the result for over long messages.
+*/
+int CTRPoly_decrypt(const CTRPoly* poly, const uint8_t* nonce, const uint8_t* aad, size_t aadLength,
+	const uint8_t* in, uint8_t* out, size_t length, const uint8_t* tag)
+{
+	uint8_t expected[CTR_POLY_TAG_SIZE];
+	uint8_t diff = 0;
+
+	if (!validLength(poly, length))
+	{
+		CTRMode_wipe(out, length);
+		return -1;
+	}
+
+	polyCrypt(poly, nonce, aad, aadLength, in, out, length, expected, 0);
+
+	// constant time comparison
+	for (int i = 0; i < CTR_POLY_TAG_SIZE; i++)
+	{
+		diff |= expected[i] ^ tag[i];
+	}
+	CTRMode_wipe(expected, sizeof(expected));
+
+	if (diff != 0)
+	{
+		CTRMode_wipe(out, length);
+		return -1;
+	}
+
+	return 0;
+}
+
+void CTRPoly_final(CTRPoly* poly)
+{
+	CTRKey_final(&poly->key);
+}
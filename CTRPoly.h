@@ -0,0 +1,46 @@
+/* CTRPoly.h
+*
+ * Author: Nicolas Moura
+ * Created: 18/10/2026
+ *
+ * CTR + Poly1305 authenticated encryption on a 64 bits block
+ * cipher.
+ *
+ */
+
+#pragma once
+
+#include "CTRMode.h"
+
+// bytes of the per message nonce of CTRPoly, the first word of the counter block
+#define CTR_POLY_NONCE_SIZE 4
+
+// bytes of a CTRPoly tag
+#define CTR_POLY_TAG_SIZE 16
+
+// most data blocks of one message, counters 0 to 3 give the Poly1305 key
+#define CTR_POLY_MAX_BLOCKS (0x100000000ull - 4)
+
+/*
+	Encrypt-then-MAC AEAD on a 64 bits block cipher: CTR with a 32 bits
+	nonce and a 32 bits counter, authenticated by Poly1305 as in RFC 8439
+	with the one-time key taken from counter blocks 0 to 3. Read only
+	after CTRPoly_init.
+
+	The nonce is only 32 bits: random nonces collide after about 2^16
+	messages, so it must be a message counter kept by the caller, and the
+	key must be replaced before the counter wraps. A message is at most
+	CTR_POLY_MAX_BLOCKS blocks, so its counter never comes back to the
+	blocks of the Poly1305 key.
+*/
+typedef struct
+{
+	CTRKey key;
+} CTRPoly;
+
+int CTRPoly_init(CTRPoly* poly, enum Algorithm algorithm, const uint32_t* key);
+int CTRPoly_encrypt(const CTRPoly* poly, const uint8_t* nonce, const uint8_t* aad, size_t aadLength,
+	const uint8_t* in, uint8_t* out, size_t length, uint8_t* tag);
+int CTRPoly_decrypt(const CTRPoly* poly, const uint8_t* nonce, const uint8_t* aad, size_t aadLength,
+	const uint8_t* in, uint8_t* out, size_t length, const uint8_t* tag);
+void CTRPoly_final(CTRPoly* poly);
@@ -0,0 +1,273 @@
+/* CTRPrecompute.c
+*
+ * Author: Nicolas Moura
+ * Created: 18/10/2026
+ *
+ * Background key stream generation for streams of small messages. A
+ * producer thread keeps a ring of encrypted counter blocks ahead of the
+ * stream, so the foreground update is only the XOR with bytes already
+ * in memory. The ring is lock free; the mutex and condition variable
+ * are only used to put the producer to sleep and wake it up again.
+ *
+ */
+
+#include "CTRPrecompute.h"
+
+// blocks between the foreground position and the producer, 0 when the foreground is ahead
+static size_t fillLevel(uint64_t head, uint64_t tail)
+{
+	return (head > tail) ? (size_t)(head - tail) : 0;
+}
+
+static void* producerMain(void* arg)
+{
+	CTRPrecompute* pre = arg;
+	CTRState state;
+	int bytes = pre->key->blockBytes;
+	uint64_t head = 0;
+	uint64_t tail;
+	size_t space;
+	size_t n;
+
+	CTRState_init(&state, pre->key, pre->nonce);
+
+	while (!atomic_load(&pre->stop))
+	{
+		tail = atomic_load_explicit(&pre->tail, memory_order_acquire);
+		if (head < tail)
+		{
+			// the foreground generated these blocks itself, continue after them
+			head = tail;
+			CTRState_init(&state, pre->key, pre->nonce);
+			CTRMode_addCounter(state.ctrNonce, pre->key->blockWords, pre->key->counterWords, head);
+		}
+
+		space = pre->capacity - fillLevel(head, tail);
+		if (space == 0)
+		{
+			pthread_mutex_lock(&pre->lock);
+			atomic_store(&pre->sleeping, 1);
+			while (!atomic_load(&pre->stop)
+				&& fillLevel(head, atomic_load(&pre->tail)) > pre->lowWatermark)
+			{
+				pthread_cond_wait(&pre->wake, &pre->lock);
+			}
+			atomic_store(&pre->sleeping, 0);
+			pthread_mutex_unlock(&pre->lock);
+			continue;
+		}
+
+		// one batch at most, and never across the end of the ring
+		n = pre->capacity - (size_t)(head % pre->capacity);
+		if (n > space)
+		{
+			n = space;
+		}
+		if (n > CTR_BATCH_BLOCKS)
+		{
+			n = CTR_BATCH_BLOCKS;
+		}
+
+		CTRState_keyStream(&state, pre->ring + (head % pre->capacity) * bytes, n);
+		head += n;
+		atomic_store_explicit(&pre->head, head, memory_order_release);
+	}
+
+	return NULL;
+}
+
+/*
+	Returns the key stream of up to nrBlocks blocks starting at block tail
+	and sets nrBlocks to the number available: a contiguous run of the
+	ring when the producer is ahead, otherwise up to one batch generated
+	inline into scratch.
+*/
+static const uint8_t* nextBlocks(CTRPrecompute* pre, uint64_t tail, size_t* nrBlocks, uint8_t* scratch)
+{
+	int bytes = pre->key->blockBytes;
+	size_t ready = fillLevel(atomic_load_explicit(&pre->head, memory_order_acquire), tail);
+	size_t n = *nrBlocks;
+	CTRState state;
+
+	if (ready > 0)
+	{
+		size_t contiguous = pre->capacity - (size_t)(tail % pre->capacity);
+
+		if (n > ready)
+		{
+			n = ready;
+		}
+		if (n > contiguous)
+		{
+			n = contiguous;
+		}
+
+		*nrBlocks = n;
+		return pre->ring + (tail % pre->capacity) * bytes;
+	}
+
+	// ring drained: do not wait for the producer
+	if (n > CTR_BATCH_BLOCKS)
+	{
+		n = CTR_BATCH_BLOCKS;
+	}
+
+	CTRState_init(&state, pre->key, pre->nonce);
+	CTRMode_addCounter(state.ctrNonce, pre->key->blockWords, pre->key->counterWords, tail);
+	CTRState_keyStream(&state, scratch, n);
+	pre->inlineBlocks += n;
+
+	*nrBlocks = n;
+	return scratch;
+}
+
+// Hands the blocks before tail back to the producer, waking it at the watermark
+static void releaseBlocks(CTRPrecompute* pre, uint64_t tail)
+{
+	atomic_store(&pre->tail, tail);
+
+	if (atomic_load(&pre->sleeping)
+		&& fillLevel(atomic_load(&pre->head), tail) <= pre->lowWatermark)
+	{
+		pthread_mutex_lock(&pre->lock);
+		pthread_cond_signal(&pre->wake);
+		pthread_mutex_unlock(&pre->lock);
+	}
+}
+
+/*
+	Starts the producer for the stream (key, nonce). capacity is the ring
+	size in blocks and lowWatermark the fill level at which a sleeping
+	producer starts refilling it (capacity / 2 when 0).
+*/
+int CTRPrecompute_init(CTRPrecompute* pre, const CTRKey* key, const uint32_t* nonce, size_t capacity, size_t lowWatermark)
+{
+	size_t size;
+
+	if (capacity == 0)
+	{
+		return -1;
+	}
+
+	pre->key = key;
+	for (int i = 0; i < 4; i++)
+	{
+		pre->nonce[i] = (i < key->blockWords) ? nonce[i] : 0;
+	}
+
+	pre->capacity = capacity;
+	pre->lowWatermark = (lowWatermark == 0 || lowWatermark >= capacity) ? capacity / 2 : lowWatermark;
+	pre->inlineBlocks = 0;
+	pre->position = 0;
+
+	atomic_init(&pre->head, 0);
+	atomic_init(&pre->tail, 0);
+	atomic_init(&pre->sleeping, 0);
+	atomic_init(&pre->stop, 0);
+
+	size = (capacity * key->blockBytes + CTR_CACHE_LINE - 1) / CTR_CACHE_LINE * CTR_CACHE_LINE;
+	pre->ring = aligned_alloc(CTR_CACHE_LINE, size);
+	if (pre->ring == NULL)
+	{
+		return -1;
+	}
+
+	pthread_mutex_init(&pre->lock, NULL);
+	pthread_cond_init(&pre->wake, NULL);
+
+	if (pthread_create(&pre->thread, NULL, producerMain, pre) != 0)
+	{
+		pthread_mutex_destroy(&pre->lock);
+		pthread_cond_destroy(&pre->wake);
+		free(pre->ring);
+		pre->ring = NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+// Same result as CTRState_update on the stream, with the key stream taken from the ring
+void CTRPrecompute_update(CTRPrecompute* pre, const uint8_t* in, uint8_t* out, size_t length)
+{
+	uint8_t scratch[CTR_BATCH_BLOCKS * 16];
+	const uint8_t* keyStream;
+	int bytes = pre->key->blockBytes;
+	uint64_t tail = atomic_load_explicit(&pre->tail, memory_order_relaxed);
+	size_t nrBlocks;
+	size_t n;
+
+	if (pre->position != 0)
+	{
+		n = bytes - pre->position;
+		if (n > length)
+		{
+			n = length;
+		}
+
+		CTRMode_xorKeyStream(in, pre->keyStream + pre->position, out, n);
+		pre->position = (pre->position + n) % bytes;
+
+		in += n;
+		out += n;
+		length -= n;
+	}
+
+	while (length >= (size_t)bytes)
+	{
+		nrBlocks = length / bytes;
+		keyStream = nextBlocks(pre, tail, &nrBlocks, scratch);
+
+		n = nrBlocks * bytes;
+		CTRMode_xorKeyStream(in, keyStream, out, n);
+
+		tail += nrBlocks;
+		releaseBlocks(pre, tail);
+
+		in += n;
+		out += n;
+		length -= n;
+	}
+
+	if (length != 0)
+	{
+		nrBlocks = 1;
+		keyStream = nextBlocks(pre, tail, &nrBlocks, scratch);
+		memcpy(pre->keyStream, keyStream, bytes);
+
+		tail++;
+		releaseBlocks(pre, tail);
+
+		CTRMode_xorKeyStream(in, pre->keyStream, out, length);
+		pre->position = length;
+	}
+}
+
+// Number of key stream blocks ready in the ring
+size_t CTRPrecompute_fillLevel(CTRPrecompute* pre)
+{
+	return fillLevel(atomic_load(&pre->head), atomic_load(&pre->tail));
+}
+
+void CTRPrecompute_final(CTRPrecompute* pre)
+{
+	atomic_store(&pre->stop, 1);
+	pthread_mutex_lock(&pre->lock);
+	pthread_cond_signal(&pre->wake);
+	pthread_mutex_unlock(&pre->lock);
+
+	pthread_join(pre->thread, NULL);
+	pthread_mutex_destroy(&pre->lock);
+	pthread_cond_destroy(&pre->wake);
+
+	// the ring holds key stream, wipe it before releasing it
+	CTRMode_wipe(pre->ring, pre->capacity * pre->key->blockBytes);
+	for (int i = 0; i < 16; i++)
+	{
+		pre->keyStream[i] = 0;
+	}
+
+	free(pre->ring);
+	pre->ring = NULL;
+	pre->position = 0;
+}
@@ -0,0 +1,53 @@
+/* CTRPrecompute.h
+*
+ * Author: Nicolas Moura
+ * Created: 18/10/2026
+ *
+ * Key stream precomputed ahead of use by a background thread.
+ *
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "CTRMode.h"
+
+/*
+	Key stream precomputed by a background thread
+
+	The producer thread encrypts the upcoming counter blocks into a single
+	producer / single consumer ring; the foreground update only XORs with
+	blocks already there. head and tail count blocks from the start of the
+	stream and are the only shared data, each one written by one side.
+	When the ring is drained the foreground generates the blocks it needs
+	inline and the producer skips past them. The producer sleeps while
+	the ring is full and is woken once the fill level drops to
+	lowWatermark.
+*/
+typedef struct
+{
+	_Alignas(CTR_CACHE_LINE) _Atomic uint64_t head;	// next block written by the producer
+	_Alignas(CTR_CACHE_LINE) _Atomic uint64_t tail;	// next block used by the foreground
+	_Alignas(CTR_CACHE_LINE) _Atomic int sleeping;
+	_Atomic int stop;
+
+	const CTRKey* key;
+	uint32_t nonce[4];		// counter block of block 0
+	uint8_t* ring;			// capacity key stream blocks
+	size_t capacity;		// in blocks
+	size_t lowWatermark;	// in blocks
+	uint64_t inlineBlocks;	// blocks the foreground had to generate itself
+
+	uint8_t keyStream[16];	// current block when position != 0
+	uint8_t position;
+
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+} CTRPrecompute;
+
+int CTRPrecompute_init(CTRPrecompute* pre, const CTRKey* key, const uint32_t* nonce, size_t capacity, size_t lowWatermark);
+void CTRPrecompute_update(CTRPrecompute* pre, const uint8_t* in, uint8_t* out, size_t length);
+size_t CTRPrecompute_fillLevel(CTRPrecompute* pre);
+void CTRPrecompute_final(CTRPrecompute* pre);
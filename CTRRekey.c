@@ -0,0 +1,179 @@
+/* CTRRekey.c
+*
+ * Author: Nicolas Moura
+ * Created: 18/10/2026
+ *
+ * Periodic rekeying of long CTR streams without stalling them. The key
+ * schedule of the next epoch is derived and expanded by a helper thread
+ * while the current epoch is encrypted; at the boundary the stream only
+ * switches to the other CTRKey and restarts its counter.
+ *
+ */
+
+#include "CTRRekey.h"
+
+static void* helperMain(void* arg)
+{
+	CTRRekey* rekey = arg;
+	uint32_t keyWords[8];
+	uint64_t epoch;
+	CTRKey* next;
+
+	pthread_mutex_lock(&rekey->lock);
+
+	for (;;)
+	{
+		while (rekey->nextReady && !rekey->stop)
+		{
+			pthread_cond_wait(&rekey->wake, &rekey->lock);
+		}
+
+		if (rekey->stop)
+		{
+			break;
+		}
+
+		// the spare key is not used by the stream until nextReady is set
+		epoch = rekey->epoch + 1;
+		next = &rekey->keys[1 - rekey->current];
+		pthread_mutex_unlock(&rekey->lock);
+
+		rekey->derive(rekey->userData, epoch, keyWords);
+		CTRKey_rekey(next, keyWords);
+
+		CTRMode_wipe(keyWords, sizeof(keyWords));
+
+		pthread_mutex_lock(&rekey->lock);
+		rekey->nextReady = 1;
+		pthread_cond_signal(&rekey->ready);
+	}
+
+	pthread_mutex_unlock(&rekey->lock);
+	return NULL;
+}
+
+// Switches the stream to the key of the next epoch, waiting for it only if the helper is late
+static void nextEpoch(CTRRekey* rekey)
+{
+	pthread_mutex_lock(&rekey->lock);
+	while (!rekey->nextReady)
+	{
+		pthread_cond_wait(&rekey->ready, &rekey->lock);
+	}
+
+	rekey->current = 1 - rekey->current;
+	rekey->epoch++;
+	rekey->nextReady = 0;
+	pthread_cond_signal(&rekey->wake);
+	pthread_mutex_unlock(&rekey->lock);
+
+	CTRState_init(&rekey->state, &rekey->keys[rekey->current], rekey->nonce);
+	rekey->left = rekey->rekeyBytes;
+}
+
+/*
+	Starts a stream under key (epoch 0) that switches to derive(e) after
+	every rekeyBytes bytes, which must be a whole number of blocks.
+*/
+int CTRRekey_init(CTRRekey* rekey, enum Algorithm algorithm, const uint32_t* key, const uint32_t* nonce, uint64_t rekeyBytes, CTRRekeyDerive derive, void* userData)
+{
+	int keySize;
+	const CipherDescriptor* cipher = CipherRegistry_lookup(algorithm, &keySize);
+
+	// checked before anything is allocated
+	if (cipher == NULL || rekeyBytes == 0 || rekeyBytes % (cipher->blockSize / 8) != 0)
+	{
+		return -1;
+	}
+
+	if (CTRKey_init(&rekey->keys[0], algorithm, key) != 0)
+	{
+		return -1;
+	}
+
+	// the spare schedule is only allocated, the helper expands every next key into it
+	if (CTRKey_initLayout(&rekey->keys[1], algorithm, NULL, CTR_COUNTER_FULL) != 0)
+	{
+		CTRKey_final(&rekey->keys[0]);
+		return -1;
+	}
+
+	for (int i = 0; i < 4; i++)
+	{
+		rekey->nonce[i] = (i < rekey->keys[0].blockWords) ? nonce[i] : 0;
+	}
+
+	rekey->current = 0;
+	rekey->epoch = 0;
+	rekey->rekeyBytes = rekeyBytes;
+	rekey->left = rekeyBytes;
+	rekey->derive = derive;
+	rekey->userData = userData;
+	rekey->nextReady = 0;
+	rekey->stop = 0;
+	CTRState_init(&rekey->state, &rekey->keys[0], rekey->nonce);
+
+	pthread_mutex_init(&rekey->lock, NULL);
+	pthread_cond_init(&rekey->wake, NULL);
+	pthread_cond_init(&rekey->ready, NULL);
+
+	if (pthread_create(&rekey->thread, NULL, helperMain, rekey) != 0)
+	{
+		pthread_mutex_destroy(&rekey->lock);
+		pthread_cond_destroy(&rekey->wake);
+		pthread_cond_destroy(&rekey->ready);
+		CTRKey_final(&rekey->keys[0]);
+		CTRKey_final(&rekey->keys[1]);
+		return -1;
+	}
+
+	return 0;
+}
+
+void CTRRekey_update(CTRRekey* rekey, const uint8_t* in, uint8_t* out, size_t length)
+{
+	size_t n;
+
+	while (length > 0)
+	{
+		if (rekey->left == 0)
+		{
+			nextEpoch(rekey);
+		}
+
+		n = (length < rekey->left) ? length : (size_t)rekey->left;
+		CTRState_update(&rekey->state, in, out, n);
+		rekey->left -= n;
+
+		in += n;
+		out += n;
+		length -= n;
+	}
+}
+
+void CTRRekey_final(CTRRekey* rekey)
+{
+	pthread_mutex_lock(&rekey->lock);
+	rekey->stop = 1;
+	pthread_cond_signal(&rekey->wake);
+	pthread_mutex_unlock(&rekey->lock);
+
+	pthread_join(rekey->thread, NULL);
+	pthread_mutex_destroy(&rekey->lock);
+	pthread_cond_destroy(&rekey->wake);
+	pthread_cond_destroy(&rekey->ready);
+
+	for (int i = 0; i < 4; i++)
+	{
+		rekey->nonce[i] = 0;
+		rekey->state.nonce[i] = 0;
+		rekey->state.ctrNonce[i] = 0;
+	}
+	for (int i = 0; i < 16; i++)
+	{
+		rekey->state.keyStream[i] = 0;
+	}
+
+	CTRKey_final(&rekey->keys[0]);
+	CTRKey_final(&rekey->keys[1]);
+}
@@ -0,0 +1,50 @@
+/* CTRRekey.h
+*
+ * Author: Nicolas Moura
+ * Created: 18/10/2026
+ *
+ * CTR stream rekeyed at fixed intervals, the next key expanded
+ * by a helper thread.
+ *
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include "CTRMode.h"
+
+// Fills keyWords with the key of epoch (1, 2, ...) of a rekeyed stream
+typedef void (*CTRRekeyDerive)(void* userData, uint64_t epoch, uint32_t* keyWords);
+
+/*
+	Stream rekeyed every rekeyBytes bytes
+
+	Epoch e encrypts with the key derive(e) from the counter block nonce.
+	A helper thread derives and expands the key of the next epoch into the
+	spare CTRKey while the current one is in use, so the switch at the
+	epoch boundary is only a swap of the two keys.
+*/
+typedef struct
+{
+	CTRKey keys[2];			// current and next epoch
+	CTRState state;
+	uint32_t nonce[4];		// first counter block of every epoch
+	int current;			// index in keys of the current epoch
+	uint64_t epoch;
+	uint64_t rekeyBytes;	// a whole number of blocks
+	uint64_t left;			// bytes before the next rekey
+
+	CTRRekeyDerive derive;
+	void* userData;
+
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;	// next key needed
+	pthread_cond_t ready;	// next key expanded
+	int nextReady;
+	int stop;
+} CTRRekey;
+
+int CTRRekey_init(CTRRekey* rekey, enum Algorithm algorithm, const uint32_t* key, const uint32_t* nonce, uint64_t rekeyBytes, CTRRekeyDerive derive, void* userData);
+void CTRRekey_update(CTRRekey* rekey, const uint8_t* in, uint8_t* out, size_t length);
+void CTRRekey_final(CTRRekey* rekey);
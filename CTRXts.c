@@ -0,0 +1,248 @@
+/* CTRXts.c
+*
+ * Author: Nicolas Moura
+ * Created: 18/10/2026
+ *
+ * XTS (IEEE 1619) on the 128 bits ciphers of the library, for sector
+ * addressed storage. The blocks of a sector only depend on each other
+ * through their tweaks, so the tweaks are XORed in, the whole sector
+ * goes through the multi-block kernel in one call, and the tweaks are
+ * XORed in again. The tweaks come from 8 independent lanes stepped by
+ * alpha^8, instead of one chain of doublings through the whole sector.
+ *
+ */
+
+#include "CTRXts.h"
+
+// tweak lanes, block j uses lane j % XTS_LANES
+#define XTS_LANES 8
+
+// t = t * alpha, t[0] being the low half
+static void doubleTweak(uint64_t* t)
+{
+	uint64_t carry = (t[1] >> 63) * 0x87;
+
+	t[1] = (t[1] << 1) | (t[0] >> 63);
+	t[0] = (t[0] << 1) ^ carry;
+}
+
+// t = t * alpha^8: a byte shift, the byte shifted out folded back times x^7 + x^2 + x + 1
+static void stepTweak(uint64_t* t)
+{
+	uint64_t b = t[1] >> 56;
+
+	t[1] = (t[1] << 8) | (t[0] >> 56);
+	t[0] = (t[0] << 8) ^ b ^ (b << 1) ^ (b << 2) ^ (b << 7);
+}
+
+/*
+	out = in ^ T * alpha^j for the blocks j < nrBlocks, T being tweak.
+	next receives T * alpha^nrBlocks, the tweak of the following block.
+*/
+static void xorTweaks(const uint64_t* tweak, const uint8_t* in, uint8_t* out, size_t nrBlocks, uint64_t* next)
+{
+	uint64_t lanes[XTS_LANES][2];
+	size_t j = 0;
+	int k;
+
+	lanes[0][0] = tweak[0];
+	lanes[0][1] = tweak[1];
+	for (k = 1; k < XTS_LANES; k++)
+	{
+		lanes[k][0] = lanes[k - 1][0];
+		lanes[k][1] = lanes[k - 1][1];
+		doubleTweak(lanes[k]);
+	}
+
+	for (; j + XTS_LANES <= nrBlocks; j += XTS_LANES)
+	{
+		for (k = 0; k < XTS_LANES; k++)
+		{
+			const uint8_t* src = in + 16 * (j + k);
+			uint8_t* dst = out + 16 * (j + k);
+
+			STORE64_LE(dst, LOAD64_LE(src) ^ lanes[k][0]);
+			STORE64_LE(dst + 8, LOAD64_LE(src + 8) ^ lanes[k][1]);
+			stepTweak(lanes[k]);
+		}
+	}
+
+	for (k = 0; j + k < nrBlocks; k++)
+	{
+		const uint8_t* src = in + 16 * (j + k);
+		uint8_t* dst = out + 16 * (j + k);
+
+		STORE64_LE(dst, LOAD64_LE(src) ^ lanes[k][0]);
+		STORE64_LE(dst + 8, LOAD64_LE(src + 8) ^ lanes[k][1]);
+	}
+
+	// lanes below k are one group ahead, lane k is at block nrBlocks
+	next[0] = lanes[k][0];
+	next[1] = lanes[k][1];
+
+	CTRMode_wipe(lanes, sizeof(lanes));
+}
+
+// One block through crypt between two XORs with tweak, for ciphertext stealing
+static void cryptBlock(CipherEncryptBlocks crypt, const void* keySchedule, const uint64_t* tweak, const uint8_t* in, uint8_t* out)
+{
+	uint64_t unused[2];
+
+	xorTweaks(tweak, in, out, 1, unused);
+	crypt(keySchedule, out, out, 1);
+	xorTweaks(tweak, out, out, 1, unused);
+}
+
+/*
+	Encrypts (encrypt != 0) or decrypts one sector whose encrypted sector
+	number is tweakBlock. A partial last block steals the end of the
+	previous one's ciphertext.
+*/
+static void xtsSector(const CTRXts* xts, const uint8_t* tweakBlock, const uint8_t* in, uint8_t* out, int encrypt)
+{
+	CipherEncryptBlocks crypt = encrypt ? xts->dataKey.encryptBlocks : xts->dataKey.cipher->decryptBlocks;
+	const void* keySchedule = xts->dataKey.keySchedule;
+	size_t nrBlocks = xts->sectorSize / 16;
+	size_t last = xts->sectorSize % 16;
+	size_t bulk = (last != 0) ? nrBlocks - 1 : nrBlocks;
+	uint64_t tweak[2];
+	uint64_t next[2];
+	uint64_t after[2];
+	uint8_t stolen[16];
+	uint8_t* tail;
+
+	tweak[0] = LOAD64_LE(tweakBlock);
+	tweak[1] = LOAD64_LE(tweakBlock + 8);
+
+	xorTweaks(tweak, in, out, bulk, next);
+	crypt(keySchedule, out, out, bulk);
+	xorTweaks(tweak, out, out, bulk, next);
+
+	if (last != 0)
+	{
+		in += 16 * bulk;
+		out += 16 * bulk;
+		tail = out + 16;
+
+		// the two last blocks use T * alpha^(n - 1) and T * alpha^n, swapped when decrypting
+		after[0] = next[0];
+		after[1] = next[1];
+		doubleTweak(after);
+
+		cryptBlock(crypt, keySchedule, encrypt ? next : after, in, stolen);
+
+		// the partial block may share its bytes with tail, read it before writing tail
+		for (size_t i = 0; i < last; i++)
+		{
+			uint8_t partial = in[16 + i];
+
+			tail[i] = stolen[i];
+			stolen[i] = partial;
+		}
+
+		cryptBlock(crypt, keySchedule, encrypt ? after : next, stolen, out);
+
+		CTRMode_wipe(after, sizeof(after));
+		CTRMode_wipe(stolen, sizeof(stolen));
+	}
+
+	CTRMode_wipe(tweak, sizeof(tweak));
+	CTRMode_wipe(next, sizeof(next));
+}
+
+/*
+	Encrypts or decrypts nrSectors consecutive sectors starting at sector
+	first. The sector numbers of up to one batch of sectors are encrypted
+	together with the tweak key.
+*/
+static void xtsSectors(const CTRXts* xts, uint64_t first, const uint8_t* in, uint8_t* out, size_t nrSectors, int encrypt)
+{
+	uint8_t tweaks[CTR_BATCH_BLOCKS * 16];
+	size_t n;
+
+	while (nrSectors > 0)
+	{
+		n = (nrSectors < CTR_BATCH_BLOCKS) ? nrSectors : CTR_BATCH_BLOCKS;
+
+		// the sector number as a 128 bits little endian integer
+		memset(tweaks, 0, 16 * n);
+		for (size_t i = 0; i < n; i++)
+		{
+			STORE64_LE(tweaks + 16 * i, first + i);
+		}
+		xts->tweakKey.encryptBlocks(xts->tweakKey.keySchedule, tweaks, tweaks, n);
+
+		for (size_t i = 0; i < n; i++)
+		{
+			xtsSector(xts, tweaks + 16 * i, in, out, encrypt);
+			in += xts->sectorSize;
+			out += xts->sectorSize;
+		}
+
+		first += n;
+		nrSectors -= n;
+	}
+
+	CTRMode_wipe(tweaks, sizeof(tweaks));
+}
+
+/*
+	Expands the data key (Key1) and the tweak key (Key2), both of the same
+	128 bits block cipher, which must be able to decrypt. sectorSize is
+	the size in bytes of every sector, at least one block.
+*/
+int CTRXts_init(CTRXts* xts, enum Algorithm algorithm, const uint32_t* dataKey, const uint32_t* tweakKey, size_t sectorSize)
+{
+	if (sectorSize < 16)
+	{
+		return -1;
+	}
+
+	if (CTRKey_init(&xts->dataKey, algorithm, dataKey) != 0)
+	{
+		return -1;
+	}
+
+	if (xts->dataKey.blockBytes != 16 || xts->dataKey.cipher->decryptBlocks == NULL)
+	{
+		CTRKey_final(&xts->dataKey);
+		return -1;
+	}
+
+	if (CTRKey_init(&xts->tweakKey, algorithm, tweakKey) != 0)
+	{
+		CTRKey_final(&xts->dataKey);
+		return -1;
+	}
+
+	xts->sectorSize = sectorSize;
+	return 0;
+}
+
+// Encrypts the sectorSize bytes of sector from in to out (may be the same buffer)
+void CTRXts_encryptSector(const CTRXts* xts, uint64_t sector, const uint8_t* in, uint8_t* out)
+{
+	xtsSectors(xts, sector, in, out, 1, 1);
+}
+
+void CTRXts_decryptSector(const CTRXts* xts, uint64_t sector, const uint8_t* in, uint8_t* out)
+{
+	xtsSectors(xts, sector, in, out, 1, 0);
+}
+
+// Encrypts nrSectors contiguous sectors, numbered from first
+void CTRXts_encryptSectors(const CTRXts* xts, uint64_t first, const uint8_t* in, uint8_t* out, size_t nrSectors)
+{
+	xtsSectors(xts, first, in, out, nrSectors, 1);
+}
+
+void CTRXts_decryptSectors(const CTRXts* xts, uint64_t first, const uint8_t* in, uint8_t* out, size_t nrSectors)
+{
+	xtsSectors(xts, first, in, out, nrSectors, 0);
+}
+
+void CTRXts_final(CTRXts* xts)
+{
+	CTRKey_final(&xts->dataKey);
+	CTRKey_final(&xts->tweakKey);
+}
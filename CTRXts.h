@@ -0,0 +1,33 @@
+/* CTRXts.h
+*
+ * Author: Nicolas Moura
+ * Created: 18/10/2026
+ *
+ * XTS (IEEE 1619) sector encryption on a 128 bits block cipher.
+ *
+ */
+
+#pragma once
+
+#include "CTRMode.h"
+
+/*
+	XTS (IEEE 1619) on a 128 bits block cipher that can also decrypt
+
+	The data unit is a sector of sectorSize bytes numbered by the caller,
+	a partial last block is handled by ciphertext stealing. Read only
+	after CTRXts_init.
+*/
+typedef struct
+{
+	CTRKey dataKey;		// Key1, encrypts the data
+	CTRKey tweakKey;	// Key2, encrypts the sector numbers
+	size_t sectorSize;	// in bytes, at least one block
+} CTRXts;
+
+int CTRXts_init(CTRXts* xts, enum Algorithm algorithm, const uint32_t* dataKey, const uint32_t* tweakKey, size_t sectorSize);
+void CTRXts_encryptSector(const CTRXts* xts, uint64_t sector, const uint8_t* in, uint8_t* out);
+void CTRXts_decryptSector(const CTRXts* xts, uint64_t sector, const uint8_t* in, uint8_t* out);
+void CTRXts_encryptSectors(const CTRXts* xts, uint64_t first, const uint8_t* in, uint8_t* out, size_t nrSectors);
+void CTRXts_decryptSectors(const CTRXts* xts, uint64_t first, const uint8_t* in, uint8_t* out, size_t nrSectors);
+void CTRXts_final(CTRXts* xts);
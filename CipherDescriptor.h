@@ -0,0 +1,127 @@
+/* CipherDescriptor.h
+*
+ * Author: Nicolas Moura
+ * Created: 18/10/2026
+ *
+ * Description of a block cipher as seen by the modes of operation.
+ * Each cipher exports one descriptor and the registry maps every
+ * enum Algorithm value to a descriptor and a key size, so the modes
+ * resolve the cipher once at context creation and then only call
+ * through the function pointers.
+ *
+ * Blocks are exchanged as byte buffers in big endian order (8 bytes for
+ * 64 bits blocks, 16 for 128 bits). Each cipher loads them straight into
+ * its native word size, the buffers do not need any alignment.
+ *
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define CIPHER_MAX_KEY_SIZES 3
+
+// Unaligned big endian loads and stores, compiled to a single mov (+ bswap)
+static inline uint16_t LOAD16_BE(const uint8_t* p)
+{
+	return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static inline void STORE16_BE(uint8_t* p, uint16_t x)
+{
+	p[0] = (uint8_t)(x >> 8);
+	p[1] = (uint8_t)x;
+}
+
+static inline uint32_t LOAD32_BE(const uint8_t* p)
+{
+	uint32_t x;
+	memcpy(&x, p, sizeof(x));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	x = __builtin_bswap32(x);
+#endif
+	return x;
+}
+
+static inline void STORE32_BE(uint8_t* p, uint32_t x)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	x = __builtin_bswap32(x);
+#endif
+	memcpy(p, &x, sizeof(x));
+}
+
+static inline uint64_t LOAD64_BE(const uint8_t* p)
+{
+	uint64_t x;
+	memcpy(&x, p, sizeof(x));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	x = __builtin_bswap64(x);
+#endif
+	return x;
+}
+
+static inline void STORE64_BE(uint8_t* p, uint64_t x)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	x = __builtin_bswap64(x);
+#endif
+	memcpy(p, &x, sizeof(x));
+}
+
+// Little endian counterparts, for the modes whose standards use that order (Poly1305, XTS)
+static inline uint64_t LOAD64_LE(const uint8_t* p)
+{
+	uint64_t x;
+	memcpy(&x, p, sizeof(x));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	x = __builtin_bswap64(x);
+#endif
+	return x;
+}
+
+static inline void STORE64_LE(uint8_t* p, uint64_t x)
+{
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	x = __builtin_bswap64(x);
+#endif
+	memcpy(p, &x, sizeof(x));
+}
+
+// expands key (keySize bits, as 32 bits words) into the cipher context
+typedef void (*CipherKeySetup)(void* context, const uint32_t* key, int keySize);
+
+// encrypts nrBlocks contiguous blocks, in and out may be the same buffer
+typedef void (*CipherEncryptBlocks)(const void* context, const uint8_t* in, uint8_t* out, size_t nrBlocks);
+
+// decrypts nrBlocks contiguous blocks, the inverse of CipherEncryptBlocks
+typedef void (*CipherDecryptBlocks)(const void* context, const uint8_t* in, uint8_t* out, size_t nrBlocks);
+
+// returns non zero when the running CPU supports the SIMD variants
+typedef int (*CipherSimdSupported)(void);
+
+// copies the round keys of context into lane of a multi key lane layout
+typedef void (*CipherLoadLane)(void* lanes, int lane, const void* context);
+
+// encrypts nrBlocks groups of one block per lane, group g of lane l at block g * nrLanes + l
+typedef void (*CipherEncryptLanes)(const void* lanes, const uint8_t* in, uint8_t* out, size_t nrBlocks);
+
+typedef struct
+{
+	const char* name;
+	int blockSize;							// in bits
+	int keySizes[CIPHER_MAX_KEY_SIZES];		// supported key sizes in bits, unused entries are 0
+	size_t contextSize;
+	size_t contextAlign;
+	CipherKeySetup init;
+	CipherEncryptBlocks encryptBlocks;
+	CipherEncryptBlocks encryptBlocksSimd;	// optional, NULL when there is no SIMD kernel
+	CipherSimdSupported simdSupported;		// optional, NULL means always supported
+	size_t lanesSize;						// size of the multi key lane layout, 0 when there is none
+	int nrLanes;							// keys encrypted side by side by encryptLanes
+	CipherLoadLane loadLane;				// optional, NULL when there is no lane kernel
+	CipherEncryptLanes encryptLanes;
+	CipherDecryptBlocks decryptBlocks;		// optional, NULL when the cipher cannot decrypt
+} CipherDescriptor;
@@ -0,0 +1,93 @@
+/* CipherRegistry.c
+*
+ * Author: Nicolas Moura
+ * Created: 18/10/2026
+ *
+ * Maps each enum Algorithm value to the descriptor of its block
+ * cipher and the key size it selects. New ciphers or kernels are
+ * added here and in their own algorithm folder only.
+ *
+ */
+
+#include "CTRMode.h"
+#include "algorithms/ARIA/ARIA.h"
+#include "algorithms/CAMELLIA/CAMELLIA.h"
+#include "algorithms/NOEKEON/NOEKEON.h"
+#include "algorithms/SEED/SEED.h"
+#include "algorithms/SIMON/SIMON.h"
+#include "algorithms/SPECK/SPECK.h"
+#include "algorithms/IDEA/IDEA.h"
+#include "algorithms/PRESENT/PRESENT.h"
+#include "algorithms/HIGHT/HIGHT.h"
+#include "algorithms/GOST/GOST.h"
+
+typedef struct
+{
+	enum Algorithm algorithm;
+	const CipherDescriptor* cipher;
+	int keySize;
+} CipherRegistryEntry;
+
+static const CipherRegistryEntry registry[] =
+{
+	{ ARIA_128, &ARIA_descriptor, 128 },
+	{ ARIA_192, &ARIA_descriptor, 192 },
+	{ ARIA_256, &ARIA_descriptor, 256 },
+	{ CAMELLIA_128, &CAMELLIA_descriptor, 128 },
+	{ CAMELLIA_192, &CAMELLIA_descriptor, 192 },
+	{ CAMELLIA_256, &CAMELLIA_descriptor, 256 },
+	{ NOEKEON_128, &NOEKEON_descriptor, 128 },
+	{ SEED_128, &SEED_descriptor, 128 },
+	{ SIMON_128, &SIMON_descriptor, 128 },
+	{ SIMON_192, &SIMON_descriptor, 192 },
+	{ SIMON_256, &SIMON_descriptor, 256 },
+	{ SPECK_128, &SPECK_descriptor, 128 },
+	{ SPECK_192, &SPECK_descriptor, 192 },
+	{ SPECK_256, &SPECK_descriptor, 256 },
+	{ GOST_256, &GOST_descriptor, 256 },
+	{ IDEA_128, &IDEA_descriptor, 128 },
+	{ PRESENT_80, &PRESENT_descriptor, 80 },
+	{ PRESENT_128, &PRESENT_descriptor, 128 },
+	{ HIGHT_128, &HIGHT_descriptor, 128 }
+};
+
+const CipherDescriptor* CipherRegistry_lookup(enum Algorithm algorithm, int* keySize)
+{
+	for (size_t i = 0; i < sizeof(registry) / sizeof(registry[0]); i++)
+	{
+		if (registry[i].algorithm == algorithm)
+		{
+			if (keySize != NULL)
+			{
+				*keySize = registry[i].keySize;
+			}
+			return registry[i].cipher;
+		}
+	}
+
+	return NULL;
+}
+
+CipherEncryptBlocks CipherRegistry_encryptBlocks(const CipherDescriptor* cipher)
+{
+	// prefer the SIMD kernel when the cipher has one and the CPU supports it
+	if (cipher->encryptBlocksSimd != NULL &&
+		(cipher->simdSupported == NULL || cipher->simdSupported()))
+	{
+		return cipher->encryptBlocksSimd;
+	}
+
+	return cipher->encryptBlocks;
+}
+
+// lane kernel of the cipher, NULL when it has none or the CPU cannot run it
+CipherEncryptLanes CipherRegistry_encryptLanes(const CipherDescriptor* cipher)
+{
+	if (cipher->encryptLanes != NULL &&
+		(cipher->simdSupported == NULL || cipher->simdSupported()))
+	{
+		return cipher->encryptLanes;
+	}
+
+	return NULL;
+}
@@ -100,7 +100,7 @@ const uint8_t SB4[256] = {
 								0x25, 0x8a, 0xb5, 0xe7, 0x42, 0xb3, 0xc7, 0xea, 0xf7, 0x4c, 0x11, 0x33, 0x03, 0xa2, 0xac, 0x60
 };
 
-static void XOR_128(uint32_t* y, uint32_t* x)
+static void XOR_128(uint32_t* y, const uint32_t* x)
 {
 	y[0] ^= x[0];
 	y[1] ^= x[1];
@@ -255,7 +255,7 @@ static void A(uint32_t* input, uint32_t* output)
 	output[3] = y12 << 24 | y13 << 16 | y14 << 8 | y15;
 }
 
-static void FO(uint32_t* D, uint32_t* RK, uint32_t* output)
+static void FO(const uint32_t* D, const uint32_t* RK, uint32_t* output)
 {
 	// A(SL1(D ^ RK))
 	uint32_t y[4];
@@ -271,7 +271,7 @@ static void FO(uint32_t* D, uint32_t* RK, uint32_t* output)
 	A(y, output);
 }
 
-static void FE(uint32_t* D, uint32_t* RK, uint32_t* output)
+static void FE(const uint32_t* D, const uint32_t* RK, uint32_t* output)
 {
 	// A(SL2(D ^ RK))
 	uint32_t y[4];
@@ -359,6 +359,22 @@ static void generateEncryptionKeys(uint32_t* W0,
 	XOR_128(eks[16], W0);
 }
 
+/*
+	dk1 = ek(n), dki = A(ek(n + 1 - i)) for 1 < i < n, dkn = ek1
+	with n the number of round keys
+*/
+static void generateDecryptionKeys(uint32_t rounds, uint32_t eks[][4], uint32_t dks[][4])
+{
+	uint32_t last = rounds - 1;
+
+	MOV_128(dks[0], eks[last]);
+	for (uint32_t i = 1; i < last; i++)
+	{
+		A(eks[last - i], dks[i]);
+	}
+	MOV_128(dks[last], eks[0]);
+}
+
 void ARIA_init(AriaContext* context, const uint32_t* key, uint32_t keyLength)
 {
 	uint32_t W0[4];
@@ -426,46 +442,186 @@ void ARIA_init(AriaContext* context, const uint32_t* key, uint32_t keyLength)
 
 	// generate encryption and decryption keys
 	generateEncryptionKeys(W0, W1, W2, W3, context->eks);
+	generateDecryptionKeys(context->rounds, context->eks, context->dks);
 }
 
-void ARIA_encrypt(AriaContext* context, uint32_t* block, uint32_t* P)
+/*
+	Runs the rounds with the key table keys: ARIA is an involution SPN, so
+	decryption is the same structure with the decryption keys.
+*/
+static void crypt(uint32_t rounds, const uint32_t keys[][4], const uint32_t* block, uint32_t* P)
 {
 	uint32_t round = 0;
 	uint32_t subkey = 0;
-	void (*roundFunctions[2]) (uint32_t* D, uint32_t* RK, uint32_t* output) = { FE, FO };
+	void (*roundFunctions[2]) (const uint32_t* D, const uint32_t* RK, uint32_t* output) = { FE, FO };
 
 	MOV_128(P, block);
 
 	// encryption rounds
-	for (round = 1; round <= context->rounds - 2; round++)
+	for (round = 1; round <= rounds - 2; round++)
 	{
 		// optimize if condifion using array of function pointer to point to even/odd function
-		(*roundFunctions[round % 2])(P, context->eks[subkey++], P);
+		(*roundFunctions[round % 2])(P, keys[subkey++], P);
+	}
+
+	// last step is different with last two keys
+	// C = SL2(P11 ^ ek12) ^ ek13;
+	XOR_128(P, keys[subkey++]);
 
-		/*if (round % 2 != 0)
+	SL2(P, P);
+
+	XOR_128(P, keys[subkey++]);
+}
+
+void ARIA_encrypt(AriaContext* context, const uint32_t* block, uint32_t* P)
+{
+	crypt(context->rounds, context->eks, block, P);
+}
+
+void ARIA_decrypt(const AriaContext* context, const uint32_t* block, uint32_t* P)
+{
+	crypt(context->rounds, context->dks, block, P);
+}
+
+void ARIA_keySetup(AriaContext* context, const uint32_t* key, int key_size)
+{
+	ARIA_init(context, key, key_size);
+}
+
+/*
+	Runs the two states P0 and P1 in place through the rounds of keys.
+	Both blocks go through the rounds together so their s-box lookups
+	overlap and each round key is loaded once for both.
+*/
+static void cryptTwo(uint32_t rounds, const uint32_t keys[][4], uint32_t* P0, uint32_t* P1)
+{
+	uint32_t round;
+	uint32_t subkey;
+
+	for (round = 1, subkey = 0; round <= rounds - 2; round++, subkey++)
+	{
+		if (round % 2 != 0)
 		{
-			FO(P, context->eks[subkey++], P);
+			FO(P0, keys[subkey], P0);
+			FO(P1, keys[subkey], P1);
 		}
 		else
 		{
-			FE(P, context->eks[subkey++], P);
-		}*/
+			FE(P0, keys[subkey], P0);
+			FE(P1, keys[subkey], P1);
+		}
 	}
 
-	// last step is different with last two keys
-	// C = SL2(P11 ^ ek12) ^ ek13;
-	XOR_128(P, context->eks[subkey++]);
+	XOR_128(P0, keys[subkey]);
+	XOR_128(P1, keys[subkey]);
+	SL2(P0, P0);
+	SL2(P1, P1);
+	XOR_128(P0, keys[subkey + 1]);
+	XOR_128(P1, keys[subkey + 1]);
+}
 
-	SL2(P, P);
+// Encrypts nrBlocks contiguous blocks of 4 words each
+void ARIA_encryptBlocks(const AriaContext* context, const uint32_t* in, uint32_t* out, size_t nrBlocks)
+{
+	uint32_t P0[4];
+	uint32_t P1[4];
+	size_t i = 0;
 
-	XOR_128(P, context->eks[subkey++]);
+	for (; i + 2 <= nrBlocks; i += 2)
+	{
+		MOV_128(P0, &in[4 * i]);
+		MOV_128(P1, &in[4 * i + 4]);
+		cryptTwo(context->rounds, context->eks, P0, P1);
+		MOV_128(&out[4 * i], P0);
+		MOV_128(&out[4 * i + 4], P1);
+	}
+
+	if (i < nrBlocks)
+	{
+		crypt(context->rounds, context->eks, &in[4 * i], &out[4 * i]);
+	}
 }
 
-void ARIA_main(CTRCounter* ctrNonce, int key_size)
+// Runs nrBlocks contiguous 16 bytes blocks through keys, loading the words directly
+static void cryptBytes(uint32_t rounds, const uint32_t keys[][4], const uint8_t* in, uint8_t* out, size_t nrBlocks)
 {
-	AriaContext context;
-	ARIA_init(&context, ctrNonce->Key, key_size);
-	ARIA_encrypt(&context, ctrNonce->ctrNonce, ctrNonce->cipherText);
-	
-	return;
+	uint32_t P0[4];
+	uint32_t P1[4];
+	int j;
+	size_t i = 0;
+
+	for (; i + 2 <= nrBlocks; i += 2, in += 32, out += 32)
+	{
+		for (j = 0; j < 4; j++)
+		{
+			P0[j] = LOAD32_BE(in + 4 * j);
+			P1[j] = LOAD32_BE(in + 16 + 4 * j);
+		}
+
+		cryptTwo(rounds, keys, P0, P1);
+
+		for (j = 0; j < 4; j++)
+		{
+			STORE32_BE(out + 4 * j, P0[j]);
+			STORE32_BE(out + 16 + 4 * j, P1[j]);
+		}
+	}
+
+	if (i < nrBlocks)
+	{
+		for (j = 0; j < 4; j++)
+		{
+			P0[j] = LOAD32_BE(in + 4 * j);
+		}
+
+		crypt(rounds, keys, P0, P0);
+
+		for (j = 0; j < 4; j++)
+		{
+			STORE32_BE(out + 4 * j, P0[j]);
+		}
+	}
 }
+
+void ARIA_encryptBytes(const AriaContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	cryptBytes(context->rounds, context->eks, in, out, nrBlocks);
+}
+
+void ARIA_decryptBytes(const AriaContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	cryptBytes(context->rounds, context->dks, in, out, nrBlocks);
+}
+
+static void descriptorKeySetup(void* context, const uint32_t* key, int keySize)
+{
+	ARIA_keySetup(context, key, keySize);
+}
+
+static void descriptorEncryptBlocks(const void* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	ARIA_encryptBytes(context, in, out, nrBlocks);
+}
+
+static void descriptorDecryptBlocks(const void* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	ARIA_decryptBytes(context, in, out, nrBlocks);
+}
+
+const CipherDescriptor ARIA_descriptor =
+{
+	"ARIA",
+	128,
+	{ 128, 192, 256 },
+	sizeof(AriaContext),
+	_Alignof(AriaContext),
+	descriptorKeySetup,
+	descriptorEncryptBlocks,
+	NULL,
+	NULL,
+	0,
+	0,
+	NULL,
+	NULL,
+	descriptorDecryptBlocks
+};
@@ -16,9 +16,17 @@ typedef struct
 	uint32_t rounds;
 	// each subkey is 4 parts of 32 bits
 	uint32_t eks[17][4];
+	uint32_t dks[17][4];
 } AriaContext;
 
 void ARIA_init(AriaContext* context, const uint32_t* key, uint32_t keyLength);
-void ARIA_encrypt(AriaContext* context, uint32_t* block, uint32_t* P);
+void ARIA_encrypt(AriaContext* context, const uint32_t* block, uint32_t* P);
+void ARIA_decrypt(const AriaContext* context, const uint32_t* block, uint32_t* P);
 
-void ARIA_main(CTRCounter* ctrCounter, int key_size);
+void ARIA_encryptBlocks(const AriaContext* context, const uint32_t* in, uint32_t* out, size_t nrBlocks);
+void ARIA_encryptBytes(const AriaContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks);
+void ARIA_decryptBytes(const AriaContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks);
+
+void ARIA_keySetup(AriaContext* context, const uint32_t* key, int key_size);
+
+extern const CipherDescriptor ARIA_descriptor;
@@ -384,9 +384,22 @@ void CAMELLIA_init(CamelliaContext* context, const uint64_t* key, uint16_t keyLe
 		context->k[i++] = temp[0];
 		context->k[i++] = temp[1];
 	}
+
+	// decryption uses the subkeys in reverse order, kw3 / kw4 and kw1 / kw2 keep their places
+	for (i = 0; i < context->nrSubkeys; i++)
+	{
+		context->dk[i] = context->k[context->nrSubkeys - 1 - i];
+	}
+	temp[0] = context->dk[0];
+	context->dk[0] = context->dk[1];
+	context->dk[1] = temp[0];
+	temp[0] = context->dk[context->nrSubkeys - 2];
+	context->dk[context->nrSubkeys - 2] = context->dk[context->nrSubkeys - 1];
+	context->dk[context->nrSubkeys - 1] = temp[0];
 }
 
-void CAMELLIA_encrypt(const CamelliaContext* context, const uint64_t* block, uint64_t* out)
+// Runs block through the rounds with the subkeys k, in encryption or decryption order
+static void crypt(uint16_t feistelIterations, const uint64_t* k, const uint64_t* block, uint64_t* out)
 {
 	// D[0] is D1 and D[1] is D2
 	uint64_t D[2] = { block[0], block[1] };
@@ -396,12 +409,12 @@ void CAMELLIA_encrypt(const CamelliaContext* context, const uint64_t* block, uin
 	uint16_t round;
 	uint16_t feistelIteration;
 
-	D[0] ^= context->k[subkey++]; // Prewhitening
-	D[1] ^= context->k[subkey++];
+	D[0] ^= k[subkey++]; // Prewhitening
+	D[1] ^= k[subkey++];
 
 	// if 128-bits key then its 18 rounds divided into 3 feistel iterations
 	// if 192/256-bits key then its 24 rounds and divided into 4 feistel iterations
-	for (feistelIteration = 0; feistelIteration < context->feistelIterations; feistelIteration++)
+	for (feistelIteration = 0; feistelIteration < feistelIterations; feistelIteration++)
 	{
 		// each feistel iteration is 6 rounds
 		for (round = 1; round <= 6; round++)
@@ -411,81 +424,207 @@ void CAMELLIA_encrypt(const CamelliaContext* context, const uint64_t* block, uin
 			oppositeIndex = (~dIndex & 0x1);
 
 			// D1 is calculated in even rounds and D2 in odd rounds
-			D[dIndex] ^= F(D[oppositeIndex], context->k[subkey++]);
+			D[dIndex] ^= F(D[oppositeIndex], k[subkey++]);
 		}
 
 		// do not insert FL and FLINV functions in last iteration
-		if (feistelIteration != (context->feistelIterations - 1))
+		if (feistelIteration != (feistelIterations - 1))
 		{
 			// between each feistel iteration FL and FLINV functions are inserted
-			D[0] = FL(D[0], context->k[subkey++]);
-			D[1] = FLINV(D[1], context->k[subkey++]);
+			D[0] = FL(D[0], k[subkey++]);
+			D[1] = FLINV(D[1], k[subkey++]);
 		}
 	}
 
-	D[1] ^= context->k[subkey++]; // Postwhitening
-	D[0] ^= context->k[subkey++];
+	D[1] ^= k[subkey++]; // Postwhitening
+	D[0] ^= k[subkey++];
 
 	// copy cipher text to output
 	out[0] = D[1];
 	out[1] = D[0];
 }
 
-void CAMELLIA_main(CTRCounter* ctrNonce, int key_size)
+void CAMELLIA_encrypt(const CamelliaContext* context, const uint64_t* block, uint64_t* out)
+{
+	crypt(context->feistelIterations, context->k, block, out);
+}
+
+void CAMELLIA_decrypt(const CamelliaContext* context, const uint64_t* block, uint64_t* out)
+{
+	crypt(context->feistelIterations, context->dk, block, out);
+}
+
+void CAMELLIA_keySetup(CamelliaContext* context, const uint32_t* key, int key_size)
+{
+	uint64_t key64[4];
+	uint64_t key0 = key[0];
+	uint64_t key1 = key[1];
+	uint64_t key2 = key[2];
+	uint64_t key3 = key[3];
+
+	key64[0] = (key0 << 32) | key1;
+	key64[1] = (key2 << 32) | key3;
+	key64[2] = 0x0000000000000000;
+	key64[3] = 0x0000000000000000;
+
+	if (key_size >= 192)
+	{
+		key64[2] = ((uint64_t)key[4] << 32) | key[5];
+	}
+	if (key_size == 256)
+	{
+		key64[3] = ((uint64_t)key[6] << 32) | key[7];
+	}
+
+	CAMELLIA_init(context, key64, key_size);
+}
+
+/*
+	Runs the two blocks a and b in place through the subkeys k, with the
+	F function of both blocks interleaved.
+*/
+static void cryptTwo(uint16_t feistelIterations, const uint64_t* k, uint64_t* a, uint64_t* b)
 {
-	CamelliaContext context;
-	uint64_t key[4];
-	uint64_t text[2];
-	uint64_t cipherText[2];
-	uint64_t val0 = ctrNonce->ctrNonce[0];
-	uint64_t val1 = ctrNonce->ctrNonce[1];
-	uint64_t val2 = ctrNonce->ctrNonce[2];
-	uint64_t val3 = ctrNonce->ctrNonce[3];
-
-	uint64_t key0 = ctrNonce->Key[0];
-	uint64_t key1 = ctrNonce->Key[1];
-	uint64_t key2 = ctrNonce->Key[2];
-	uint64_t key3 = ctrNonce->Key[3];
-	uint64_t key4 = ctrNonce->Key[4];
-	uint64_t key5 = ctrNonce->Key[5];
-	uint64_t key6 = ctrNonce->Key[6];
-	uint64_t key7 = ctrNonce->Key[7];
-
-	text[0] = (val0 << 32) | val1;
-	text[1] = (val2 << 32) | val3;
-
-	switch (key_size)
+	uint16_t feistelIteration;
+	uint16_t round;
+
+	// Prewhitening
+	uint64_t a0 = a[0] ^ k[0];
+	uint64_t a1 = a[1] ^ k[1];
+	uint64_t b0 = b[0] ^ k[0];
+	uint64_t b1 = b[1] ^ k[1];
+	k += 2;
+
+	for (feistelIteration = 0; feistelIteration < feistelIterations; feistelIteration++)
 	{
-	case 128 :
-		key[0] = (key0 << 32) | key1;
-		key[1] = (key2 << 32) | key3;
-		key[2] = 0x0000000000000000;
-		key[3] = 0x0000000000000000;		
-		break;
-	case 192 :
-		key[0] = (key0 << 32) | key1;
-		key[1] = (key2 << 32) | key3;
-		key[2] = (key4 << 32) | key5;
-		key[3] = 0x0000000000000000;
-		break;
-	case 256 :
-		key[0] = (key0 << 32) | key1;
-		key[1] = (key2 << 32) | key3;
-		key[2] = (key4 << 32) | key5;
-		key[3] = (key6 << 32) | key7;
-		break;
-	
-	default:
-		break;
+		// 6 rounds, D2 is updated in odd rounds and D1 in even rounds
+		for (round = 0; round < 3; round++)
+		{
+			a1 ^= F(a0, k[0]);
+			b1 ^= F(b0, k[0]);
+			a0 ^= F(a1, k[1]);
+			b0 ^= F(b1, k[1]);
+			k += 2;
+		}
+
+		if (feistelIteration != (feistelIterations - 1))
+		{
+			a0 = FL(a0, k[0]);
+			b0 = FL(b0, k[0]);
+			a1 = FLINV(a1, k[1]);
+			b1 = FLINV(b1, k[1]);
+			k += 2;
+		}
 	}
-		
-	CAMELLIA_init(&context, key, key_size);
-	CAMELLIA_encrypt(&context, text, cipherText);
-
-	ctrNonce->cipherText[0] = (uint32_t)(cipherText[0] >> 32);
-	ctrNonce->cipherText[1] = (uint32_t)(cipherText[0]);
-	ctrNonce->cipherText[2] = (uint32_t)(cipherText[1] >> 32);
-	ctrNonce->cipherText[3] = (uint32_t)(cipherText[1]);
-	
-	return;
+
+	// Postwhitening
+	a[0] = a1 ^ k[0];
+	a[1] = a0 ^ k[1];
+	b[0] = b1 ^ k[0];
+	b[1] = b0 ^ k[1];
 }
+
+// Encrypts nrBlocks contiguous blocks of 2 uint64_t each
+void CAMELLIA_encryptBlocks(const CamelliaContext* context, const uint64_t* in, uint64_t* out, size_t nrBlocks)
+{
+	uint64_t a[2];
+	uint64_t b[2];
+	size_t i = 0;
+
+	for (; i + 2 <= nrBlocks; i += 2, in += 4, out += 4)
+	{
+		a[0] = in[0];
+		a[1] = in[1];
+		b[0] = in[2];
+		b[1] = in[3];
+
+		cryptTwo(context->feistelIterations, context->k, a, b);
+
+		out[0] = a[0];
+		out[1] = a[1];
+		out[2] = b[0];
+		out[3] = b[1];
+	}
+
+	if (i < nrBlocks)
+	{
+		CAMELLIA_encrypt(context, (uint64_t*)in, out);
+	}
+}
+
+// Runs nrBlocks contiguous 16 bytes blocks through the subkeys k, loading the halves directly
+static void cryptBytes(uint16_t feistelIterations, const uint64_t* k, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	uint64_t a[2];
+	uint64_t b[2];
+	size_t i = 0;
+
+	for (; i + 2 <= nrBlocks; i += 2, in += 32, out += 32)
+	{
+		a[0] = LOAD64_BE(in);
+		a[1] = LOAD64_BE(in + 8);
+		b[0] = LOAD64_BE(in + 16);
+		b[1] = LOAD64_BE(in + 24);
+
+		cryptTwo(feistelIterations, k, a, b);
+
+		STORE64_BE(out, a[0]);
+		STORE64_BE(out + 8, a[1]);
+		STORE64_BE(out + 16, b[0]);
+		STORE64_BE(out + 24, b[1]);
+	}
+
+	if (i < nrBlocks)
+	{
+		a[0] = LOAD64_BE(in);
+		a[1] = LOAD64_BE(in + 8);
+
+		crypt(feistelIterations, k, a, a);
+
+		STORE64_BE(out, a[0]);
+		STORE64_BE(out + 8, a[1]);
+	}
+}
+
+void CAMELLIA_encryptBytes(const CamelliaContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	cryptBytes(context->feistelIterations, context->k, in, out, nrBlocks);
+}
+
+void CAMELLIA_decryptBytes(const CamelliaContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	cryptBytes(context->feistelIterations, context->dk, in, out, nrBlocks);
+}
+
+static void descriptorKeySetup(void* context, const uint32_t* key, int keySize)
+{
+	CAMELLIA_keySetup(context, key, keySize);
+}
+
+static void descriptorEncryptBlocks(const void* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	CAMELLIA_encryptBytes(context, in, out, nrBlocks);
+}
+
+static void descriptorDecryptBlocks(const void* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	CAMELLIA_decryptBytes(context, in, out, nrBlocks);
+}
+
+const CipherDescriptor CAMELLIA_descriptor =
+{
+	"CAMELLIA",
+	128,
+	{ 128, 192, 256 },
+	sizeof(CamelliaContext),
+	_Alignof(CamelliaContext),
+	descriptorKeySetup,
+	descriptorEncryptBlocks,
+	NULL,
+	NULL,
+	0,
+	0,
+	NULL,
+	NULL,
+	descriptorDecryptBlocks
+};
@@ -16,9 +16,17 @@ typedef struct
 	uint16_t feistelIterations;
 	uint8_t nrSubkeys;
 	uint64_t k[34];
+	uint64_t dk[34];
 } CamelliaContext;
 
 void CAMELLIA_init(CamelliaContext* context, const uint64_t* key, uint16_t keyLen);
 void CAMELLIA_encrypt(const CamelliaContext* context, const uint64_t* block, uint64_t* out);
+void CAMELLIA_decrypt(const CamelliaContext* context, const uint64_t* block, uint64_t* out);
 
-void CAMELLIA_main(CTRCounter* ctrNonce, int key_size);
+void CAMELLIA_encryptBlocks(const CamelliaContext* context, const uint64_t* in, uint64_t* out, size_t nrBlocks);
+void CAMELLIA_encryptBytes(const CamelliaContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks);
+void CAMELLIA_decryptBytes(const CamelliaContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks);
+
+void CAMELLIA_keySetup(CamelliaContext* context, const uint32_t* key, int key_size);
+
+extern const CipherDescriptor CAMELLIA_descriptor;
@@ -17,12 +17,6 @@
 
 #include "GOST.h"
 
-uint32_t CM1;
-uint32_t CM2;
-uint32_t N1;
-uint32_t N2;
-uint32_t R;
-
 // S-box used by the Central Bank of Russian Federation
 const uint8_t s_box[8][16] = {
 									{ 4, 10, 9, 2, 13, 8, 0, 14, 6, 11, 1, 12, 7, 15, 5, 3 },
@@ -35,10 +29,8 @@ const uint8_t s_box[8][16] = {
 									{ 1, 15, 13, 0, 5, 7, 10, 4, 9, 2, 3, 14, 6, 11, 8, 12 }
 };
 
-void GOST_round(uint32_t xi)
+static uint32_t GOST_f(uint32_t CM1)
 {
-	CM1 = (N1 + xi) % 4294967296; // 2^32
-
 	// read entire s-box column according to the CM1 bits
 	uint32_t SN = 0;
 	for (int j = 0; j <= 7; j++)
@@ -62,36 +54,66 @@ void GOST_round(uint32_t xi)
 		SN = SN | mask;
 	}
 
-	R = SN;
-
 	// cyclic 11 shift
-	uint32_t mask = R << 11;
-	R = (R >> 21) | mask;
-
-	// modulo 2 addition
-	CM2 = R ^ N2;
-	N2 = N1;
-	N1 = CM2;
+	return (SN >> 21) | (SN << 11);
 }
 
 uint64_t GOST_encrypt(uint64_t block, uint32_t* key)
 {
-	N1 = (uint32_t)block;
-	N2 = block >> 32;
+	// round state is kept local so the cipher is reentrant
+	uint32_t N1 = (uint32_t)block;
+	uint32_t N2 = block >> 32;
+	uint32_t CM2;
 
 	// first 24 rounds
 	for (int k = 0; k < 3; k++)
 	{
 		for (int i = 0; i <= 7; i++)
 		{
-			GOST_round(key[i]);
+			// modulo 2^32 addition, substitution and modulo 2 addition
+			CM2 = GOST_f(N1 + key[i]) ^ N2;
+			N2 = N1;
+			N1 = CM2;
 		}
 	}
 
 	// last 8 rounds
 	for (int i = 7; i >= 0; i--)
 	{
-		GOST_round(key[i]);
+		CM2 = GOST_f(N1 + key[i]) ^ N2;
+		N2 = N1;
+		N1 = CM2;
+	}
+
+	uint64_t tc = N1;
+	tc = (tc << 32) | N2;
+	return tc;
+}
+
+// Same Feistel network as GOST_encrypt, with the subkeys in reverse order
+uint64_t GOST_decrypt(uint64_t block, uint32_t* key)
+{
+	uint32_t N1 = (uint32_t)block;
+	uint32_t N2 = block >> 32;
+	uint32_t CM2;
+
+	// first 8 rounds
+	for (int i = 0; i <= 7; i++)
+	{
+		CM2 = GOST_f(N1 + key[i]) ^ N2;
+		N2 = N1;
+		N1 = CM2;
+	}
+
+	// last 24 rounds
+	for (int k = 0; k < 3; k++)
+	{
+		for (int i = 7; i >= 0; i--)
+		{
+			CM2 = GOST_f(N1 + key[i]) ^ N2;
+			N2 = N1;
+			N1 = CM2;
+		}
 	}
 
 	uint64_t tc = N1;
@@ -99,16 +121,162 @@ uint64_t GOST_encrypt(uint64_t block, uint32_t* key)
 	return tc;
 }
 
-void GOST_main(CTRCounter* ctrNonce, int key_size)
+void GOST_keySetup(GostContext* context, const uint32_t* key, int key_size)
+{
+	// GOST uses the 256 bits key directly as its eight round subkeys
+	for (int i = 0; i < 8; i++)
+	{
+		context->key[i] = key[i];
+	}
+
+	// merge pairs of 4 bits s-boxes into 8 bits tables with the
+	// cyclic 11 shift already applied
+	for (int byte = 0; byte < 4; byte++)
+	{
+		for (int x = 0; x < 256; x++)
+		{
+			uint32_t SN = (uint32_t)(s_box[2 * byte][x >> 4] << 4 | s_box[2 * byte + 1][x & 0xf]) << (24 - 8 * byte);
+			context->sbox[byte][x] = (SN >> 21) | (SN << 11);
+		}
+	}
+}
+
+#define GOST_F(context, x) ((context)->sbox[0][(x) >> 24] ^ (context)->sbox[1][((x) >> 16) & 0xff] \
+							^ (context)->sbox[2][((x) >> 8) & 0xff] ^ (context)->sbox[3][(x) & 0xff])
+
+// subkeys 0..7 three times then 7..0 for encryption, 0..7 once then 7..0 three times for decryption
+static const uint8_t keyOrder[2][32] =
+{
+	{ 0, 1, 2, 3, 4, 5, 6, 7, 0, 1, 2, 3, 4, 5, 6, 7, 0, 1, 2, 3, 4, 5, 6, 7, 7, 6, 5, 4, 3, 2, 1, 0 },
+	{ 0, 1, 2, 3, 4, 5, 6, 7, 7, 6, 5, 4, 3, 2, 1, 0, 7, 6, 5, 4, 3, 2, 1, 0, 7, 6, 5, 4, 3, 2, 1, 0 }
+};
+
+/*
+	Runs the two blocks a and b in place through the 32 rounds using the
+	merged s-box tables, with the subkeys in encryption or decryption order
+*/
+static void cryptTwo(const GostContext* context, uint64_t* a, uint64_t* b, int decrypt)
+{
+	uint32_t a1, a2, b1, b2, t;
+	uint32_t k;
+	int round;
+
+	a1 = (uint32_t)*a;
+	a2 = *a >> 32;
+	b1 = (uint32_t)*b;
+	b2 = *b >> 32;
+
+	for (round = 0; round < 32; round++)
+	{
+		k = context->key[keyOrder[decrypt][round]];
+
+		t = a1 + k;
+		t = GOST_F(context, t) ^ a2;
+		a2 = a1;
+		a1 = t;
+
+		t = b1 + k;
+		t = GOST_F(context, t) ^ b2;
+		b2 = b1;
+		b1 = t;
+	}
+
+	*a = ((uint64_t)a1 << 32) | a2;
+	*b = ((uint64_t)b1 << 32) | b2;
+}
+
+// Encrypts nrBlocks contiguous blocks, two blocks per iteration
+void GOST_encryptBlocks(const GostContext* context, const uint64_t* in, uint64_t* out, size_t nrBlocks)
+{
+	uint64_t a, b;
+	size_t i = 0;
+
+	for (; i + 2 <= nrBlocks; i += 2)
+	{
+		a = in[i];
+		b = in[i + 1];
+		cryptTwo(context, &a, &b, 0);
+		out[i] = a;
+		out[i + 1] = b;
+	}
+
+	if (i < nrBlocks)
+	{
+		out[i] = GOST_encrypt(in[i], (uint32_t*)context->key);
+	}
+}
+
+// Encrypts nrBlocks contiguous 8 bytes blocks, loading them directly as 64 bits words
+void GOST_encryptBytes(const GostContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
 {
-	uint64_t val0 = ctrNonce->ctrNonce[0];
-	uint64_t val1 = ctrNonce->ctrNonce[1];
-	uint64_t text = (val0 << 32) | val1;
+	uint64_t a, b;
+	size_t i = 0;
 
-	uint64_t cipherText = GOST_encrypt(text, ctrNonce->Key);	
+	for (; i + 2 <= nrBlocks; i += 2, in += 16, out += 16)
+	{
+		a = LOAD64_BE(in);
+		b = LOAD64_BE(in + 8);
+		cryptTwo(context, &a, &b, 0);
+		STORE64_BE(out, a);
+		STORE64_BE(out + 8, b);
+	}
 
-	ctrNonce->cipherText[0] = (uint32_t)(cipherText >> 32);
-	ctrNonce->cipherText[1] = (uint32_t)(cipherText);
-	ctrNonce->cipherText[2] = 0x00000000;
-	ctrNonce->cipherText[3] = 0x00000000;
+	if (i < nrBlocks)
+	{
+		STORE64_BE(out, GOST_encrypt(LOAD64_BE(in), (uint32_t*)context->key));
+	}
 }
+
+// Decrypts nrBlocks contiguous 8 bytes blocks, loading them directly as 64 bits words
+void GOST_decryptBytes(const GostContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	uint64_t a, b;
+	size_t i = 0;
+
+	for (; i + 2 <= nrBlocks; i += 2, in += 16, out += 16)
+	{
+		a = LOAD64_BE(in);
+		b = LOAD64_BE(in + 8);
+		cryptTwo(context, &a, &b, 1);
+		STORE64_BE(out, a);
+		STORE64_BE(out + 8, b);
+	}
+
+	if (i < nrBlocks)
+	{
+		STORE64_BE(out, GOST_decrypt(LOAD64_BE(in), (uint32_t*)context->key));
+	}
+}
+
+static void descriptorKeySetup(void* context, const uint32_t* key, int keySize)
+{
+	GOST_keySetup(context, key, keySize);
+}
+
+static void descriptorEncryptBlocks(const void* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	GOST_encryptBytes(context, in, out, nrBlocks);
+}
+
+static void descriptorDecryptBlocks(const void* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	GOST_decryptBytes(context, in, out, nrBlocks);
+}
+
+const CipherDescriptor GOST_descriptor =
+{
+	"GOST",
+	64,
+	{ 256, 0, 0 },
+	sizeof(GostContext),
+	_Alignof(GostContext),
+	descriptorKeySetup,
+	descriptorEncryptBlocks,
+	NULL,
+	NULL,
+	0,
+	0,
+	NULL,
+	NULL,
+	descriptorDecryptBlocks
+};
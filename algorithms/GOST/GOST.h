@@ -11,6 +11,19 @@
 #include <stdint.h>
 #include "../../CTRMode.h"
 
+typedef struct
+{
+	uint32_t key[8];
+	uint32_t sbox[4][256];	// pairs of s-boxes merged, cyclic shift included
+} GostContext;
+
 uint64_t GOST_encrypt(uint64_t block, uint32_t* key);
+uint64_t GOST_decrypt(uint64_t block, uint32_t* key);
+
+void GOST_encryptBlocks(const GostContext* context, const uint64_t* in, uint64_t* out, size_t nrBlocks);
+void GOST_encryptBytes(const GostContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks);
+void GOST_decryptBytes(const GostContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks);
+
+void GOST_keySetup(GostContext* context, const uint32_t* key, int key_size);
 
-void GOST_main(CTRCounter* ctrNonce, int key_size);
+extern const CipherDescriptor GOST_descriptor;
@@ -84,6 +84,25 @@ static void HIGHT_round(uint8_t* x,
 	x[0] = temp7 ^ (f0(temp6) + subkey3);
 }
 
+// Inverse of HIGHT_round with the same subkeys
+static void HIGHT_inverseRound(uint8_t* x,
+						 uint8_t subkey0,
+						 uint8_t subkey1,
+						 uint8_t subkey2,
+						 uint8_t subkey3)
+{
+	uint8_t temp0 = x[0];
+
+	x[0] = x[1];
+	x[1] = x[2] - (f1(x[1]) ^ subkey0);
+	x[2] = x[3];
+	x[3] = x[4] ^ (f0(x[3]) + subkey1);
+	x[4] = x[5];
+	x[5] = x[6] - (f1(x[5]) ^ subkey2);
+	x[6] = x[7];
+	x[7] = temp0 ^ (f0(x[7]) + subkey3);
+}
+
 void HIGHT_init(HightContext* context, uint8_t* key)
 {
 	int i;
@@ -147,46 +166,211 @@ void HIGHT_encrypt(HightContext* context, uint8_t* block, uint8_t* out)
 	out[7] = x[0];
 }
 
-void HIGHT_main(CTRCounter* ctrNonce, int key_size)
-{
-	HightContext context;
-	uint8_t key[16];
-	uint8_t text[8];
-	uint8_t cipherText[8];
-
-	key[0] = ctrNonce->Key[0] >> 24;
-	key[1] = ctrNonce->Key[0] >> 16;
-	key[2] = ctrNonce->Key[0] >> 8;
-	key[3] = ctrNonce->Key[0];
-	key[4] = ctrNonce->Key[1] >> 24;
-	key[5] = ctrNonce->Key[1] >> 16;
-	key[6] = ctrNonce->Key[1] >> 8;
-	key[7] = ctrNonce->Key[1];
-	key[8] = ctrNonce->Key[2] >> 24;
-	key[9] = ctrNonce->Key[2] >> 16;
-	key[10] = ctrNonce->Key[2] >> 8;
-	key[11] = ctrNonce->Key[2];
-	key[12] = ctrNonce->Key[3] >> 24;
-	key[13] = ctrNonce->Key[3] >> 16;
-	key[14] = ctrNonce->Key[3] >> 8;
-	key[15] = ctrNonce->Key[3];
-
-	text[0] = ctrNonce->ctrNonce[0] >> 24;
-	text[1] = ctrNonce->ctrNonce[0] >> 16;
-	text[2] = ctrNonce->ctrNonce[0] >> 8;
-	text[3] = ctrNonce->ctrNonce[0];
-	text[4] = ctrNonce->ctrNonce[1] >> 24;
-	text[5] = ctrNonce->ctrNonce[1] >> 16;
-	text[6] = ctrNonce->ctrNonce[1] >> 8;
-	text[7] = ctrNonce->ctrNonce[1];
-
-	HIGHT_init(&context, key);
-	HIGHT_encrypt(&context, text, cipherText);
-
-	ctrNonce->cipherText[0] = (uint32_t)(cipherText[0] << 24) | (uint32_t)(cipherText[1] << 16) 
-								| (uint32_t)(cipherText[2] << 8) | (uint32_t)(cipherText[3]);
-	ctrNonce->cipherText[1] = (uint32_t)(cipherText[4] << 24) | (uint32_t)(cipherText[5] << 16) 
-								| (uint32_t)(cipherText[6] << 8) | (uint32_t)(cipherText[7]);
-	ctrNonce->cipherText[2] = 0x00000000;
-	ctrNonce->cipherText[3] = 0x00000000;
+void HIGHT_decrypt(const HightContext* context, const uint8_t* block, uint8_t* out)
+{
+	int r;
+	uint8_t x[8];
+
+	// Inverse Final Transformation
+	x[1] = block[0] - context->whiteningKeys[4];
+	x[2] = block[1];
+	x[3] = block[2] ^ context->whiteningKeys[5];
+	x[4] = block[3];
+	x[5] = block[4] - context->whiteningKeys[6];
+	x[6] = block[5];
+	x[7] = block[6] ^ context->whiteningKeys[7];
+	x[0] = block[7];
+
+	// Rounds, last one first
+	for (r = NR_ROUNDS - 1; r >= 0; r--)
+	{
+		HIGHT_inverseRound(x, context->subkeys[4 * r], context->subkeys[4 * r + 1], context->subkeys[4 * r + 2], context->subkeys[4 * r + 3]);
+	}
+
+	// Inverse Initial Transformation
+	out[0] = x[0] - context->whiteningKeys[0];
+	out[1] = x[1];
+	out[2] = x[2] ^ context->whiteningKeys[1];
+	out[3] = x[3];
+	out[4] = x[4] - context->whiteningKeys[2];
+	out[5] = x[5];
+	out[6] = x[6] ^ context->whiteningKeys[3];
+	out[7] = x[7];
+}
+
+void HIGHT_keySetup(HightContext* context, const uint32_t* key, int key_size)
+{
+	uint8_t key8[16];
+	int i;
+
+	for (i = 0; i < 4; i++)
+	{
+		key8[4 * i] = key[i] >> 24;
+		key8[4 * i + 1] = key[i] >> 16;
+		key8[4 * i + 2] = key[i] >> 8;
+		key8[4 * i + 3] = key[i];
+	}
+
+	HIGHT_init(context, key8);
 }
+
+/*
+	Encrypts nrBlocks contiguous blocks (8 bytes each), two blocks per
+	iteration sharing the subkey loads of every round.
+*/
+void HIGHT_encryptBlocks(const HightContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	const uint8_t* wk = context->whiteningKeys;
+	const uint8_t* sk;
+	uint8_t a[8];
+	uint8_t b[8];
+	uint8_t r;
+	size_t i = 0;
+
+	for (; i + 2 <= nrBlocks; i += 2, in += 16, out += 16)
+	{
+		// Initial Transformation
+		a[0] = in[0] + wk[0];
+		a[1] = in[1];
+		a[2] = in[2] ^ wk[1];
+		a[3] = in[3];
+		a[4] = in[4] + wk[2];
+		a[5] = in[5];
+		a[6] = in[6] ^ wk[3];
+		a[7] = in[7];
+		b[0] = in[8] + wk[0];
+		b[1] = in[9];
+		b[2] = in[10] ^ wk[1];
+		b[3] = in[11];
+		b[4] = in[12] + wk[2];
+		b[5] = in[13];
+		b[6] = in[14] ^ wk[3];
+		b[7] = in[15];
+
+		// Rounds
+		for (r = 0, sk = context->subkeys; r < NR_ROUNDS; r++, sk += 4)
+		{
+			HIGHT_round(a, sk[0], sk[1], sk[2], sk[3]);
+			HIGHT_round(b, sk[0], sk[1], sk[2], sk[3]);
+		}
+
+		// Final Transformation
+		out[0] = a[1] + wk[4];
+		out[1] = a[2];
+		out[2] = a[3] ^ wk[5];
+		out[3] = a[4];
+		out[4] = a[5] + wk[6];
+		out[5] = a[6];
+		out[6] = a[7] ^ wk[7];
+		out[7] = a[0];
+		out[8] = b[1] + wk[4];
+		out[9] = b[2];
+		out[10] = b[3] ^ wk[5];
+		out[11] = b[4];
+		out[12] = b[5] + wk[6];
+		out[13] = b[6];
+		out[14] = b[7] ^ wk[7];
+		out[15] = b[0];
+	}
+
+	if (i < nrBlocks)
+	{
+		HIGHT_encrypt((HightContext*)context, (uint8_t*)in, out);
+	}
+}
+
+// Decrypts nrBlocks contiguous blocks (8 bytes each), two blocks per iteration
+void HIGHT_decryptBlocks(const HightContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	const uint8_t* wk = context->whiteningKeys;
+	const uint8_t* sk;
+	uint8_t a[8];
+	uint8_t b[8];
+	int r;
+	size_t i = 0;
+
+	for (; i + 2 <= nrBlocks; i += 2, in += 16, out += 16)
+	{
+		// Inverse Final Transformation
+		a[1] = in[0] - wk[4];
+		a[2] = in[1];
+		a[3] = in[2] ^ wk[5];
+		a[4] = in[3];
+		a[5] = in[4] - wk[6];
+		a[6] = in[5];
+		a[7] = in[6] ^ wk[7];
+		a[0] = in[7];
+		b[1] = in[8] - wk[4];
+		b[2] = in[9];
+		b[3] = in[10] ^ wk[5];
+		b[4] = in[11];
+		b[5] = in[12] - wk[6];
+		b[6] = in[13];
+		b[7] = in[14] ^ wk[7];
+		b[0] = in[15];
+
+		// Rounds, last one first
+		for (r = NR_ROUNDS - 1, sk = context->subkeys + 4 * (NR_ROUNDS - 1); r >= 0; r--, sk -= 4)
+		{
+			HIGHT_inverseRound(a, sk[0], sk[1], sk[2], sk[3]);
+			HIGHT_inverseRound(b, sk[0], sk[1], sk[2], sk[3]);
+		}
+
+		// Inverse Initial Transformation
+		out[0] = a[0] - wk[0];
+		out[1] = a[1];
+		out[2] = a[2] ^ wk[1];
+		out[3] = a[3];
+		out[4] = a[4] - wk[2];
+		out[5] = a[5];
+		out[6] = a[6] ^ wk[3];
+		out[7] = a[7];
+		out[8] = b[0] - wk[0];
+		out[9] = b[1];
+		out[10] = b[2] ^ wk[1];
+		out[11] = b[3];
+		out[12] = b[4] - wk[2];
+		out[13] = b[5];
+		out[14] = b[6] ^ wk[3];
+		out[15] = b[7];
+	}
+
+	if (i < nrBlocks)
+	{
+		HIGHT_decrypt(context, in, out);
+	}
+}
+
+static void descriptorKeySetup(void* context, const uint32_t* key, int keySize)
+{
+	HIGHT_keySetup(context, key, keySize);
+}
+
+static void descriptorEncryptBlocks(const void* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	// HIGHT already works on the bytes in big endian order
+	HIGHT_encryptBlocks(context, in, out, nrBlocks);
+}
+
+static void descriptorDecryptBlocks(const void* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	HIGHT_decryptBlocks(context, in, out, nrBlocks);
+}
+
+const CipherDescriptor HIGHT_descriptor =
+{
+	"HIGHT",
+	64,
+	{ 128, 0, 0 },
+	sizeof(HightContext),
+	_Alignof(HightContext),
+	descriptorKeySetup,
+	descriptorEncryptBlocks,
+	NULL,
+	NULL,
+	0,
+	0,
+	NULL,
+	NULL,
+	descriptorDecryptBlocks
+};
@@ -19,5 +19,11 @@ typedef struct
 
 void HIGHT_init(HightContext* context, uint8_t* key);
 void HIGHT_encrypt(HightContext* context, uint8_t* block, uint8_t* out);
+void HIGHT_decrypt(const HightContext* context, const uint8_t* block, uint8_t* out);
 
-void HIGHT_main(CTRCounter* ctrNonce, int key_size);
+void HIGHT_encryptBlocks(const HightContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks);
+void HIGHT_decryptBlocks(const HightContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks);
+
+void HIGHT_keySetup(HightContext* context, const uint32_t* key, int key_size);
+
+extern const CipherDescriptor HIGHT_descriptor;
@@ -67,6 +67,53 @@ static void generateEncryptionKeys(uint16_t* key, uint16_t Z[52])
 	}
 }
 
+// Multiplicative inverse modulo 65537 (0 standing for 65536), x^65535 by Fermat
+static uint16_t mulInverse(uint16_t x)
+{
+	uint64_t base = (x == 0) ? 65536 : x;
+	uint64_t result = 1;
+
+	for (uint32_t e = 65535; e != 0; e >>= 1)
+	{
+		if (e & 1)
+		{
+			result = result * base % 65537;
+		}
+		base = base * base % 65537;
+	}
+
+	return (uint16_t)result;
+}
+
+/*
+	Decryption subkeys: the rounds in reverse order with the multiplication
+	keys inverted and the addition keys negated. The addition keys of the
+	inner rounds are swapped, as the rounds swap x1 and x2.
+*/
+static void generateDecryptionKeys(const uint16_t Z[52], uint16_t DK[52])
+{
+	int r;
+
+	for (r = 0; r <= NR_ROUNDS; r++)
+	{
+		const uint16_t* z = Z + 6 * (NR_ROUNDS - r);
+		uint16_t* dk = DK + 6 * r;
+		int swap = (r != 0 && r != NR_ROUNDS);
+
+		dk[0] = mulInverse(z[0]);
+		dk[1] = -z[swap ? 2 : 1];
+		dk[2] = -z[swap ? 1 : 2];
+		dk[3] = mulInverse(z[3]);
+
+		// MA keys of the encryption round before, the output transformation has none
+		if (r != NR_ROUNDS)
+		{
+			dk[4] = Z[6 * (NR_ROUNDS - r - 1) + 4];
+			dk[5] = Z[6 * (NR_ROUNDS - r - 1) + 5];
+		}
+	}
+}
+
 static void idea(uint16_t* block, uint16_t* Z, uint16_t* out)
 {
 	uint16_t i;
@@ -109,6 +156,7 @@ static void idea(uint16_t* block, uint16_t* Z, uint16_t* out)
 void IDEA_init(IdeaContext* context, uint16_t* key)
 {
 	generateEncryptionKeys(key, context->encryptionKeys);
+	generateDecryptionKeys(context->encryptionKeys, context->decryptionKeys);
 }
 
 void IDEA_encrypt(IdeaContext* context, uint16_t* block, uint16_t* out)
@@ -116,33 +164,193 @@ void IDEA_encrypt(IdeaContext* context, uint16_t* block, uint16_t* out)
 	idea(block, context->encryptionKeys, out);
 }
 
-void IDEA_main(CTRCounter* ctrNonce, int key_size)
+void IDEA_decrypt(const IdeaContext* context, const uint16_t* block, uint16_t* out)
 {
-	IdeaContext context;
-	uint16_t key[8];
-	uint16_t text[4];
-	uint16_t cipherText[4];
+	idea((uint16_t*)block, (uint16_t*)context->decryptionKeys, out);
+}
 
-	text[0] = ctrNonce->ctrNonce[0] >> 16;
-	text[1] = ctrNonce->ctrNonce[0];
-	text[2] = ctrNonce->ctrNonce[1] >> 16;
-	text[3] = ctrNonce->ctrNonce[1];
+void IDEA_keySetup(IdeaContext* context, const uint32_t* key, int key_size)
+{
+	uint16_t key16[8];
 
-	key[0] = ctrNonce->Key[0];
-	key[1] = ctrNonce->Key[1];
-	key[2] = ctrNonce->Key[2];
-	key[3] = ctrNonce->Key[3];
-	key[4] = ctrNonce->Key[4];
-	key[5] = ctrNonce->Key[5];
-	key[6] = ctrNonce->Key[6];
-	key[7] = ctrNonce->Key[7];
+	// each key word holds one 16 bits part of the 128 bits key
+	for (int i = 0; i < 8; i++)
+	{
+		key16[i] = key[i];
+	}
 
-	IDEA_init(&context, key);
-	IDEA_encrypt(&context, text, cipherText);
+	IDEA_init(context, key16);
+}
 
-	ctrNonce->cipherText[0] = (uint32_t)(cipherText[0] << 16) | (uint32_t)(cipherText[1]);
-	ctrNonce->cipherText[1] = (uint32_t)(cipherText[2] << 16) | (uint32_t)(cipherText[3]);
-	ctrNonce->cipherText[2] = 0x00000000;
-	ctrNonce->cipherText[3] = 0x00000000;
+/*
+	Runs the two blocks x and y (4 uint16_t each) in place through the
+	subkeys keys, encryption or decryption ones. The rounds of both blocks
+	are interleaved so the latency of the modular multiplications of one
+	block is hidden behind the other.
+*/
+static void cryptTwo(const uint16_t* keys, uint16_t* x, uint16_t* y)
+{
+	const uint16_t* Z;
+	uint16_t r;
+	uint16_t a, b, c, d;
+	uint16_t x0 = x[0], x1 = x[1], x2 = x[2], x3 = x[3];
+	uint16_t y0 = y[0], y1 = y[1], y2 = y[2], y3 = y[3];
+
+	for (r = 1, Z = keys; r <= NR_ROUNDS; r++, Z += 6)
+	{
+		// confusion / group operations
+		x0 = mul(Z[0], x0);
+		y0 = mul(Z[0], y0);
+		x1 += Z[1];
+		y1 += Z[1];
+		x2 += Z[2];
+		y2 += Z[2];
+		x3 = mul(Z[3], x3);
+		y3 = mul(Z[3], y3);
+
+		// diffusion / MA (multiplication-addition) structure
+		b = mul(Z[4], x0 ^ x2);
+		d = mul(Z[4], y0 ^ y2);
+		a = mul(Z[5], b + (x1 ^ x3));
+		c = mul(Z[5], d + (y1 ^ y3));
+		b += a;
+		d += c;
 
+		// involuntary permutation
+		x0 = a ^ x0;
+		y0 = c ^ y0;
+		x3 = b ^ x3;
+		y3 = d ^ y3;
+		b ^= x1;
+		d ^= y1;
+		x1 = a ^ x2;
+		y1 = c ^ y2;
+		x2 = b;
+		y2 = d;
+	}
+
+	// output transformation
+	x[0] = mul(Z[0], x0);
+	x[1] = Z[1] + x2;
+	x[2] = Z[2] + x1;
+	x[3] = mul(Z[3], x3);
+	y[0] = mul(Z[0], y0);
+	y[1] = Z[1] + y2;
+	y[2] = Z[2] + y1;
+	y[3] = mul(Z[3], y3);
 }
+
+// Encrypts nrBlocks contiguous blocks of 4 uint16_t each
+void IDEA_encryptBlocks(const IdeaContext* context, const uint16_t* in, uint16_t* out, size_t nrBlocks)
+{
+	uint16_t x[4];
+	uint16_t y[4];
+	int j;
+	size_t i = 0;
+
+	for (; i + 2 <= nrBlocks; i += 2, in += 8, out += 8)
+	{
+		for (j = 0; j < 4; j++)
+		{
+			x[j] = in[j];
+			y[j] = in[4 + j];
+		}
+
+		cryptTwo(context->encryptionKeys, x, y);
+
+		for (j = 0; j < 4; j++)
+		{
+			out[j] = x[j];
+			out[4 + j] = y[j];
+		}
+	}
+
+	if (i < nrBlocks)
+	{
+		idea((uint16_t*)in, (uint16_t*)context->encryptionKeys, out);
+	}
+}
+
+// Runs nrBlocks contiguous 8 bytes blocks through keys, loading the 16 bits words directly
+static void cryptBytes(const uint16_t* keys, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	uint16_t x[4];
+	uint16_t y[4];
+	int j;
+	size_t i = 0;
+
+	for (; i + 2 <= nrBlocks; i += 2, in += 16, out += 16)
+	{
+		for (j = 0; j < 4; j++)
+		{
+			x[j] = LOAD16_BE(in + 2 * j);
+			y[j] = LOAD16_BE(in + 8 + 2 * j);
+		}
+
+		cryptTwo(keys, x, y);
+
+		for (j = 0; j < 4; j++)
+		{
+			STORE16_BE(out + 2 * j, x[j]);
+			STORE16_BE(out + 8 + 2 * j, y[j]);
+		}
+	}
+
+	if (i < nrBlocks)
+	{
+		for (j = 0; j < 4; j++)
+		{
+			x[j] = LOAD16_BE(in + 2 * j);
+		}
+
+		idea(x, (uint16_t*)keys, x);
+
+		for (j = 0; j < 4; j++)
+		{
+			STORE16_BE(out + 2 * j, x[j]);
+		}
+	}
+}
+
+void IDEA_encryptBytes(const IdeaContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	cryptBytes(context->encryptionKeys, in, out, nrBlocks);
+}
+
+void IDEA_decryptBytes(const IdeaContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	cryptBytes(context->decryptionKeys, in, out, nrBlocks);
+}
+
+static void descriptorKeySetup(void* context, const uint32_t* key, int keySize)
+{
+	IDEA_keySetup(context, key, keySize);
+}
+
+static void descriptorEncryptBlocks(const void* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	IDEA_encryptBytes(context, in, out, nrBlocks);
+}
+
+static void descriptorDecryptBlocks(const void* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	IDEA_decryptBytes(context, in, out, nrBlocks);
+}
+
+const CipherDescriptor IDEA_descriptor =
+{
+	"IDEA",
+	64,
+	{ 128, 0, 0 },
+	sizeof(IdeaContext),
+	_Alignof(IdeaContext),
+	descriptorKeySetup,
+	descriptorEncryptBlocks,
+	NULL,
+	NULL,
+	0,
+	0,
+	NULL,
+	NULL,
+	descriptorDecryptBlocks
+};
@@ -15,9 +15,17 @@
 typedef struct
 {
 	uint16_t encryptionKeys[52];
+	uint16_t decryptionKeys[52];
 } IdeaContext;
 
 void IDEA_init(IdeaContext* context, uint16_t* key);
 void IDEA_encrypt(IdeaContext* context, uint16_t* block, uint16_t* out);
+void IDEA_decrypt(const IdeaContext* context, const uint16_t* block, uint16_t* out);
 
-void IDEA_main(CTRCounter* ctrNonce, int key_size);
+void IDEA_encryptBlocks(const IdeaContext* context, const uint16_t* in, uint16_t* out, size_t nrBlocks);
+void IDEA_encryptBytes(const IdeaContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks);
+void IDEA_decryptBytes(const IdeaContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks);
+
+void IDEA_keySetup(IdeaContext* context, const uint32_t* key, int key_size);
+
+extern const CipherDescriptor IDEA_descriptor;
@@ -20,37 +20,6 @@
 #include "NOEKEON.h"
 
 #define NR_ROUNDS 16
-#define STREAM (256 * 8)
-
-uint8_t LFSR() {
-
-        unsigned char in_s, cs, cp, p, nbit, s[STREAM];
-        int i, j, k=0;
-
-
-        in_s = 0xb4;     /* this can be any 8 bit value */
-        p = 0x71;        /* max length polynomial x^8+x^4+x^3+x^2+1 = 0b01110001 */
-
-        cs = in_s;      /* copy initial state */
-
-                for (j = 0;j < 8;j++,k++) {
-                        cp = nbit = cs & p;
-
-                        for (i = 1;i < 8; i++) { /* xor all bits together */
-                                nbit ^= (cp >> i);
-                        }
-                        s[k] = cs & 0x01;
-                        cs = (cs >> 1) | (nbit << 7); /*  rotate in new bit */
-                }
-
-                if (cs == in_s) {
-                         return 0x00;
-                }
-		else{
-			return cs;
-		}
-
-}
 
 static const uint32_t RC[] =
 {
@@ -153,18 +122,209 @@ void NOEKEON_encrypt(uint32_t* block, uint32_t* key, uint32_t* encryptdBlock)
 	theta(key, encryptdBlock);
 }
 
-void NOEKEON_main(CTRCounter* ctrNonce, int key_size)
+// key is the decryption working key, theta of the cipher key with a null key
+void NOEKEON_decrypt(uint32_t* block, uint32_t* key, uint32_t* decryptedBlock)
+{
+	MOV_128(decryptedBlock, block);
+	for (int i = NR_ROUNDS; i > 0; i--)
+	{
+		NOEKEON_round(key, decryptedBlock, 0, RC[i]);
+	}
+
+	theta(key, decryptedBlock);
+	decryptedBlock[0] ^= RC[0];
+}
+
+void NOEKEON_keySetup(NoekeonContext* context, const uint32_t* key, int key_size)
+{
+	// direct-key mode: the cipher key is used as the working key
+	MOV_128(context->key, (uint32_t*)key);
+
+	// decryption runs the inverse rounds with theta applied to the key
+	uint32_t nullVector[4] = { 0, 0, 0, 0 };
+	MOV_128(context->decryptKey, (uint32_t*)key);
+	theta(nullVector, context->decryptKey);
+}
+
+// Encrypts the two states a and b in place, running their rounds side by side
+static void encryptTwo(const NoekeonContext* context, uint32_t* a, uint32_t* b)
+{
+	for (int round = 0; round < NR_ROUNDS; round++)
+	{
+		a[0] ^= RC[round];
+		b[0] ^= RC[round];
+		theta(context->key, a);
+		theta(context->key, b);
+		pi1(a);
+		pi1(b);
+		gamma(a);
+		gamma(b);
+		pi2(a);
+		pi2(b);
+	}
+
+	a[0] ^= RC[NR_ROUNDS];
+	b[0] ^= RC[NR_ROUNDS];
+	theta(context->key, a);
+	theta(context->key, b);
+}
+
+// Decrypts the two states a and b in place, running their inverse rounds side by side
+static void decryptTwo(const NoekeonContext* context, uint32_t* a, uint32_t* b)
+{
+	for (int round = NR_ROUNDS; round > 0; round--)
+	{
+		theta(context->decryptKey, a);
+		theta(context->decryptKey, b);
+		a[0] ^= RC[round];
+		b[0] ^= RC[round];
+		pi1(a);
+		pi1(b);
+		gamma(a);
+		gamma(b);
+		pi2(a);
+		pi2(b);
+	}
+
+	theta(context->decryptKey, a);
+	theta(context->decryptKey, b);
+	a[0] ^= RC[0];
+	b[0] ^= RC[0];
+}
+
+// Encrypts nrBlocks contiguous blocks of 4 words each
+void NOEKEON_encryptBlocks(const NoekeonContext* context, const uint32_t* in, uint32_t* out, size_t nrBlocks)
+{
+	uint32_t a[4];
+	uint32_t b[4];
+	size_t i = 0;
+
+	for (; i + 2 <= nrBlocks; i += 2)
+	{
+		MOV_128(a, (uint32_t*)&in[4 * i]);
+		MOV_128(b, (uint32_t*)&in[4 * i + 4]);
+		encryptTwo(context, a, b);
+		MOV_128(&out[4 * i], a);
+		MOV_128(&out[4 * i + 4], b);
+	}
+
+	if (i < nrBlocks)
+	{
+		NOEKEON_encrypt((uint32_t*)&in[4 * i], (uint32_t*)context->key, &out[4 * i]);
+	}
+}
+
+// Encrypts nrBlocks contiguous 16 bytes blocks, loading the words directly
+void NOEKEON_encryptBytes(const NoekeonContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
 {
-	int i;
-	uint32_t counter32[4];
-	uint8_t counter[16];
-	for(i=0; i<16; i++){
-		counter[i] = LFSR();
+	uint32_t a[4];
+	uint32_t b[4];
+	int j;
+	size_t i = 0;
+
+	for (; i + 2 <= nrBlocks; i += 2, in += 32, out += 32)
+	{
+		for (j = 0; j < 4; j++)
+		{
+			a[j] = LOAD32_BE(in + 4 * j);
+			b[j] = LOAD32_BE(in + 16 + 4 * j);
+		}
+
+		encryptTwo(context, a, b);
+
+		for (j = 0; j < 4; j++)
+		{
+			STORE32_BE(out + 4 * j, a[j]);
+			STORE32_BE(out + 16 + 4 * j, b[j]);
+		}
 	}
-	for(i=0; i<4; i++){
-		counter32[i] = (((uint32_t)counter[4*i+3]) << 24) + (((uint32_t)counter[4*i+2]) << 16) + (((uint32_t)counter[4*i+1]) << 8) + (uint32_t)counter[4*i];
+
+	if (i < nrBlocks)
+	{
+		for (j = 0; j < 4; j++)
+		{
+			a[j] = LOAD32_BE(in + 4 * j);
+		}
+
+		NOEKEON_encrypt(a, (uint32_t*)context->key, a);
+
+		for (j = 0; j < 4; j++)
+		{
+			STORE32_BE(out + 4 * j, a[j]);
+		}
 	}
+}
+
+// Decrypts nrBlocks contiguous 16 bytes blocks, loading the words directly
+void NOEKEON_decryptBytes(const NoekeonContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	uint32_t a[4];
+	uint32_t b[4];
+	int j;
+	size_t i = 0;
 
-	NOEKEON_encrypt(counter32, ctrNonce->Key, ctrNonce->cipherText);	
-	return;
+	for (; i + 2 <= nrBlocks; i += 2, in += 32, out += 32)
+	{
+		for (j = 0; j < 4; j++)
+		{
+			a[j] = LOAD32_BE(in + 4 * j);
+			b[j] = LOAD32_BE(in + 16 + 4 * j);
+		}
+
+		decryptTwo(context, a, b);
+
+		for (j = 0; j < 4; j++)
+		{
+			STORE32_BE(out + 4 * j, a[j]);
+			STORE32_BE(out + 16 + 4 * j, b[j]);
+		}
+	}
+
+	if (i < nrBlocks)
+	{
+		for (j = 0; j < 4; j++)
+		{
+			a[j] = LOAD32_BE(in + 4 * j);
+		}
+
+		NOEKEON_decrypt(a, (uint32_t*)context->decryptKey, a);
+
+		for (j = 0; j < 4; j++)
+		{
+			STORE32_BE(out + 4 * j, a[j]);
+		}
+	}
+}
+
+static void descriptorKeySetup(void* context, const uint32_t* key, int keySize)
+{
+	NOEKEON_keySetup(context, key, keySize);
+}
+
+static void descriptorEncryptBlocks(const void* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	NOEKEON_encryptBytes(context, in, out, nrBlocks);
+}
+
+static void descriptorDecryptBlocks(const void* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	NOEKEON_decryptBytes(context, in, out, nrBlocks);
 }
+
+const CipherDescriptor NOEKEON_descriptor =
+{
+	"NOEKEON",
+	128,
+	{ 128, 0, 0 },
+	sizeof(NoekeonContext),
+	_Alignof(NoekeonContext),
+	descriptorKeySetup,
+	descriptorEncryptBlocks,
+	NULL,
+	NULL,
+	0,
+	0,
+	NULL,
+	NULL,
+	descriptorDecryptBlocks
+};
@@ -11,6 +11,19 @@
 #include <stdint.h>
 #include "../../CTRMode.h"
 
+typedef struct
+{
+	uint32_t key[4];
+	uint32_t decryptKey[4];
+} NoekeonContext;
+
 void NOEKEON_encrypt(uint32_t* block, uint32_t* key, uint32_t* encryptdBlock);
+void NOEKEON_decrypt(uint32_t* block, uint32_t* key, uint32_t* decryptedBlock);
+
+void NOEKEON_encryptBlocks(const NoekeonContext* context, const uint32_t* in, uint32_t* out, size_t nrBlocks);
+void NOEKEON_encryptBytes(const NoekeonContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks);
+void NOEKEON_decryptBytes(const NoekeonContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks);
+
+void NOEKEON_keySetup(NoekeonContext* context, const uint32_t* key, int key_size);
 
-void NOEKEON_main(CTRCounter* ctrNonce, int key_size);
+extern const CipherDescriptor NOEKEON_descriptor;
@@ -42,6 +42,97 @@ const uint8_t p[64] =
 	12, 28, 44, 60, 13, 29, 45, 61, 14, 30, 46, 62, 15, 31, 47, 63
 };
 
+/*
+	Merges the sbox and permutation layers into 8 tables, one for each
+	byte of the state: spBox[b][x] is the pLayer of byte b after both of
+	its nybbles went through the sbox. A round becomes 8 lookups.
+*/
+static void generateSpBox(PresentContext* context)
+{
+	for (int b = 0; b < 8; b++)
+	{
+		for (int x = 0; x < 256; x++)
+		{
+			uint8_t s = sbox[x >> 4] << 4 | sbox[x & 0x0f];
+			uint64_t value = 0;
+
+			for (int j = 0; j < 8; j++)
+			{
+				if ((s >> j) & 0x1)
+				{
+					// bit at position q moves to position 63 - p[63 - q]
+					int q = 56 - 8 * b + j;
+					value |= (uint64_t)1 << (63 - p[63 - q]);
+				}
+			}
+
+			context->spBox[b][x] = value;
+		}
+	}
+}
+
+// pLayer^-1: the bit at position p[i] moves back to position i (both from the left)
+static uint64_t inversePermutation(uint64_t state)
+{
+	uint64_t temp = 0;
+
+	for (int i = 0; i < 64; i++)
+	{
+		temp |= ((state >> (63 - p[i])) & 0x1) << (63 - i);
+	}
+
+	return temp;
+}
+
+/*
+	Tables of the decryption rounds. A decryption round is
+	sBoxLayer^-1(pLayer^-1(state)) ^ Ki; with t = pLayer^-1(state) it
+	becomes t = pLayer^-1(sBoxLayer^-1(t)) ^ pLayer^-1(Ki), so the inverse
+	layers merge into per byte tables as in generateSpBox and the round
+	keys are stored through pLayer^-1.
+*/
+static void generateDecryptionTables(PresentContext* context)
+{
+	uint8_t position[64];
+
+	// position[m] is the index i with p[i] = m
+	for (int i = 0; i < 64; i++)
+	{
+		position[p[i]] = i;
+	}
+
+	for (int b = 0; b < 8; b++)
+	{
+		for (int x = 0; x < 256; x++)
+		{
+			uint8_t s = isbox[x >> 4] << 4 | isbox[x & 0x0f];
+			uint64_t value = 0;
+
+			for (int j = 0; j < 8; j++)
+			{
+				if ((s >> j) & 0x1)
+				{
+					int q = 56 - 8 * b + j;
+					value |= (uint64_t)1 << (63 - position[63 - q]);
+				}
+			}
+
+			context->invSpBox[b][x] = value;
+		}
+	}
+
+	for (int x = 0; x < 256; x++)
+	{
+		context->sboxBytes[x] = sbox[x >> 4] << 4 | sbox[x & 0x0f];
+		context->isboxBytes[x] = isbox[x >> 4] << 4 | isbox[x & 0x0f];
+	}
+
+	for (int round = 0; round <= NR_ROUNDS; round++)
+	{
+		context->decryptionKeys[round] = inversePermutation(context->roundKeys[round]);
+	}
+}
+
 void PRESENT_init(PresentContext* context, uint16_t* key, uint16_t keyLen)
 {
 	uint64_t keyHigh;
@@ -111,6 +202,9 @@ void PRESENT_init(PresentContext* context, uint16_t* key, uint16_t keyLen)
 			context->roundKeys[i] = keyHigh;
 		}
 	}
+
+	generateSpBox(context);
+	generateDecryptionTables(context);
 }
 
 /*
@@ -182,32 +276,223 @@ void PRESENT_encrypt(PresentContext* context, uint16_t* block, uint16_t* out)
 	out[3] = (uint16_t)state;
 }
 
-void PRESENT_main(CTRCounter* ctrNonce, int key_size)
+void PRESENT_keySetup(PresentContext* context, const uint32_t* key, int key_size)
+{
+	uint16_t key16[8];
+
+	for (int i = 0; i < 4; i++)
+	{
+		key16[2 * i] = key[i] >> 16;
+		key16[2 * i + 1] = key[i];
+	}
+
+	PRESENT_init(context, key16, key_size);
+}
+
+static uint64_t spLayer(const PresentContext* context, uint64_t state)
+{
+	return context->spBox[0][state >> 56] ^ context->spBox[1][(uint8_t)(state >> 48)]
+		^ context->spBox[2][(uint8_t)(state >> 40)] ^ context->spBox[3][(uint8_t)(state >> 32)]
+		^ context->spBox[4][(uint8_t)(state >> 24)] ^ context->spBox[5][(uint8_t)(state >> 16)]
+		^ context->spBox[6][(uint8_t)(state >> 8)] ^ context->spBox[7][(uint8_t)state];
+}
+
+// Encrypts one 64 bits state using the merged sbox/permutation tables
+static uint64_t encryptOne(const PresentContext* context, uint64_t a)
+{
+	uint8_t round;
+
+	for (round = 0; round < NR_ROUNDS; round++)
+	{
+		a = spLayer(context, a ^ context->roundKeys[round]);
+	}
+
+	return a ^ context->roundKeys[NR_ROUNDS];
+}
+
+static uint64_t invSpLayer(const PresentContext* context, uint64_t state)
 {
-	PresentContext context;
-	uint16_t key[8];
-	uint16_t text[4];
-	uint16_t cipherText[4];
+	return context->invSpBox[0][state >> 56] ^ context->invSpBox[1][(uint8_t)(state >> 48)]
+		^ context->invSpBox[2][(uint8_t)(state >> 40)] ^ context->invSpBox[3][(uint8_t)(state >> 32)]
+		^ context->invSpBox[4][(uint8_t)(state >> 24)] ^ context->invSpBox[5][(uint8_t)(state >> 16)]
+		^ context->invSpBox[6][(uint8_t)(state >> 8)] ^ context->invSpBox[7][(uint8_t)state];
+}
 
-	text[0] = ctrNonce->ctrNonce[0] >> 16;
-	text[1] = ctrNonce->ctrNonce[0];
-	text[2] = ctrNonce->ctrNonce[1] >> 16;
-	text[3] = ctrNonce->ctrNonce[1];
+// Applies table to every byte of state
+static uint64_t substituteBytes(const uint8_t* table, uint64_t state)
+{
+	uint64_t result = 0;
 
-	key[0] = ctrNonce->Key[0] >> 16;
-	key[1] = ctrNonce->Key[0];
-	key[2] = ctrNonce->Key[1] >> 16;
-	key[3] = ctrNonce->Key[1];
-	key[4] = ctrNonce->Key[2] >> 16;
-	key[5] = ctrNonce->Key[2];
-	key[6] = ctrNonce->Key[3] >> 16;
-	key[7] = ctrNonce->Key[3];
+	for (int i = 56; i >= 0; i -= 8)
+	{
+		result |= (uint64_t)table[(uint8_t)(state >> i)] << i;
+	}
 
-	PRESENT_init(&context, key, key_size);
-	PRESENT_encrypt(&context, text, cipherText);
+	return result;
+}
 
-	ctrNonce->cipherText[0] = (uint32_t)(cipherText[0] << 16) | (uint32_t)(cipherText[1]);
-	ctrNonce->cipherText[1] = (uint32_t)(cipherText[2] << 16) | (uint32_t)(cipherText[3]);
-	ctrNonce->cipherText[2] = 0x00000000;
-	ctrNonce->cipherText[3] = 0x00000000;
+/*
+	Decrypts one 64 bits state. pLayer^-1 of the first round is the merged
+	table applied after the sbox, which cancels its inverse.
+*/
+static uint64_t decryptOne(const PresentContext* context, uint64_t a)
+{
+	int round;
+
+	a = invSpLayer(context, substituteBytes(context->sboxBytes, a ^ context->roundKeys[NR_ROUNDS]));
+	for (round = NR_ROUNDS - 1; round > 0; round--)
+	{
+		a = invSpLayer(context, a) ^ context->decryptionKeys[round];
+	}
+
+	return substituteBytes(context->isboxBytes, a) ^ context->roundKeys[0];
 }
+
+// Decrypts the two states a and b in place, sharing the round key loads
+static void decryptTwo(const PresentContext* context, uint64_t* a, uint64_t* b)
+{
+	int round;
+	uint64_t x = *a ^ context->roundKeys[NR_ROUNDS];
+	uint64_t y = *b ^ context->roundKeys[NR_ROUNDS];
+
+	x = invSpLayer(context, substituteBytes(context->sboxBytes, x));
+	y = invSpLayer(context, substituteBytes(context->sboxBytes, y));
+
+	for (round = NR_ROUNDS - 1; round > 0; round--)
+	{
+		x = invSpLayer(context, x) ^ context->decryptionKeys[round];
+		y = invSpLayer(context, y) ^ context->decryptionKeys[round];
+	}
+
+	*a = substituteBytes(context->isboxBytes, x) ^ context->roundKeys[0];
+	*b = substituteBytes(context->isboxBytes, y) ^ context->roundKeys[0];
+}
+
+// Decrypts one block, in the 16 bits words layout of PRESENT_encrypt
+void PRESENT_decrypt(const PresentContext* context, const uint16_t* block, uint16_t* out)
+{
+	uint64_t state = (uint64_t)block[0] << 48
+		| (uint64_t)block[1] << 32
+		| (uint64_t)block[2] << 16
+		| block[3];
+
+	state = decryptOne(context, state);
+
+	out[0] = (uint16_t)(state >> 48);
+	out[1] = (uint16_t)(state >> 32);
+	out[2] = (uint16_t)(state >> 16);
+	out[3] = (uint16_t)state;
+}
+
+// Encrypts the two states a and b in place, sharing the round key loads
+static void encryptTwo(const PresentContext* context, uint64_t* a, uint64_t* b)
+{
+	uint8_t round;
+	uint64_t x = *a;
+	uint64_t y = *b;
+
+	for (round = 0; round < NR_ROUNDS; round++)
+	{
+		x = spLayer(context, x ^ context->roundKeys[round]);
+		y = spLayer(context, y ^ context->roundKeys[round]);
+	}
+
+	*a = x ^ context->roundKeys[NR_ROUNDS];
+	*b = y ^ context->roundKeys[NR_ROUNDS];
+}
+
+// Encrypts nrBlocks contiguous 64 bits states, two states per iteration
+void PRESENT_encryptBlocks(const PresentContext* context, const uint64_t* in, uint64_t* out, size_t nrBlocks)
+{
+	uint64_t a, b;
+	size_t i = 0;
+
+	for (; i + 2 <= nrBlocks; i += 2)
+	{
+		a = in[i];
+		b = in[i + 1];
+		encryptTwo(context, &a, &b);
+		out[i] = a;
+		out[i + 1] = b;
+	}
+
+	if (i < nrBlocks)
+	{
+		out[i] = encryptOne(context, in[i]);
+	}
+}
+
+// Encrypts nrBlocks contiguous 8 bytes blocks, loading them directly as 64 bits states
+void PRESENT_encryptBytes(const PresentContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	uint64_t a, b;
+	size_t i = 0;
+
+	for (; i + 2 <= nrBlocks; i += 2, in += 16, out += 16)
+	{
+		a = LOAD64_BE(in);
+		b = LOAD64_BE(in + 8);
+		encryptTwo(context, &a, &b);
+		STORE64_BE(out, a);
+		STORE64_BE(out + 8, b);
+	}
+
+	if (i < nrBlocks)
+	{
+		STORE64_BE(out, encryptOne(context, LOAD64_BE(in)));
+	}
+}
+
+// Decrypts nrBlocks contiguous 8 bytes blocks, loading them directly as 64 bits states
+void PRESENT_decryptBytes(const PresentContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	uint64_t a, b;
+	size_t i = 0;
+
+	for (; i + 2 <= nrBlocks; i += 2, in += 16, out += 16)
+	{
+		a = LOAD64_BE(in);
+		b = LOAD64_BE(in + 8);
+		decryptTwo(context, &a, &b);
+		STORE64_BE(out, a);
+		STORE64_BE(out + 8, b);
+	}
+
+	if (i < nrBlocks)
+	{
+		STORE64_BE(out, decryptOne(context, LOAD64_BE(in)));
+	}
+}
+
+static void descriptorKeySetup(void* context, const uint32_t* key, int keySize)
+{
+	PRESENT_keySetup(context, key, keySize);
+}
+
+static void descriptorEncryptBlocks(const void* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	PRESENT_encryptBytes(context, in, out, nrBlocks);
+}
+
+static void descriptorDecryptBlocks(const void* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	PRESENT_decryptBytes(context, in, out, nrBlocks);
+}
+
+const CipherDescriptor PRESENT_descriptor =
+{
+	"PRESENT",
+	64,
+	{ 80, 128, 0 },
+	sizeof(PresentContext),
+	_Alignof(PresentContext),
+	descriptorKeySetup,
+	descriptorEncryptBlocks,
+	NULL,
+	NULL,
+	0,
+	0,
+	NULL,
+	NULL,
+	descriptorDecryptBlocks
+};
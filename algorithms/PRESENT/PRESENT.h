@@ -14,9 +14,21 @@
 typedef struct
 {
 	uint64_t roundKeys[32];
+	uint64_t spBox[8][256];	// sbox and permutation layers merged per state byte
+	uint64_t decryptionKeys[32];	// pLayer^-1 of the round keys
+	uint64_t invSpBox[8][256];	// inverse sbox and inverse permutation merged per state byte
+	uint8_t sboxBytes[256];		// sbox on both nybbles of a byte
+	uint8_t isboxBytes[256];	// inverse sbox on both nybbles of a byte
 } PresentContext;
 
 void PRESENT_init(PresentContext* context, uint16_t* key, uint16_t keyLen);
 void PRESENT_encrypt(PresentContext* context, uint16_t* block, uint16_t* out);
+void PRESENT_decrypt(const PresentContext* context, const uint16_t* block, uint16_t* out);
 
-void PRESENT_main(CTRCounter* ctrNonce, int key_size);
+void PRESENT_encryptBlocks(const PresentContext* context, const uint64_t* in, uint64_t* out, size_t nrBlocks);
+void PRESENT_encryptBytes(const PresentContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks);
+void PRESENT_decryptBytes(const PresentContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks);
+
+void PRESENT_keySetup(PresentContext* context, const uint32_t* key, int key_size);
+
+extern const CipherDescriptor PRESENT_descriptor;
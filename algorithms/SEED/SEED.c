@@ -229,14 +229,22 @@ void SEED_init(SeedContext* context, uint32_t* key)
 			key[3] = temp;
 		}
 	}
+
+	// decryption is the same Feistel network with the subkey pairs in reverse order
+	for (i = 0; i < 16; i++)
+	{
+		context->decryptSubkeys[i * 2] = context->subkeys[30 - i * 2];
+		context->decryptSubkeys[i * 2 + 1] = context->subkeys[31 - i * 2];
+	}
 }
 
-void SEED_encrypt(SeedContext* context, uint32_t* block, uint32_t* out)
+// Runs block through the 16 rounds with the subkey pairs of subkeys
+static void crypt(const uint32_t* subkeys, const uint32_t* block, uint32_t* out)
 {
 	int i;
 	uint32_t temp0;
 	uint32_t temp1;
-	// subkey is ascending in encryption
+	// subkey is ascending, decryption passes the pairs reversed
 	uint32_t subkey = 0;
 	// left 64 bits of block divided into 2 32 bits parts
 	uint32_t l0 = block[0];
@@ -252,7 +260,7 @@ void SEED_encrypt(SeedContext* context, uint32_t* block, uint32_t* out)
 		  R = L ^ F(Ki, R);
 		  L = T;
 		*/
-		F(r0, r1, context->subkeys[subkey], context->subkeys[subkey + 1], &temp0, &temp1);
+		F(r0, r1, subkeys[subkey], subkeys[subkey + 1], &temp0, &temp1);
 
 		temp0 ^= l0;
 		temp1 ^= l1;
@@ -267,7 +275,7 @@ void SEED_encrypt(SeedContext* context, uint32_t* block, uint32_t* out)
 	}
 
 	// last round we update l instead of r
-	F(r0, r1, context->subkeys[subkey], context->subkeys[subkey + 1], &temp0, &temp1);
+	F(r0, r1, subkeys[subkey], subkeys[subkey + 1], &temp0, &temp1);
 
 	l0 ^= temp0;
 	l1 ^= temp1;
@@ -278,9 +286,185 @@ void SEED_encrypt(SeedContext* context, uint32_t* block, uint32_t* out)
 	out[3] = r1;
 }
 
-void SEED_main(CTRCounter* ctrNonce, int key_size)
+void SEED_encrypt(SeedContext* context, uint32_t* block, uint32_t* out)
 {
-	SeedContext context;
-	SEED_init(&context, ctrNonce->Key);
-	SEED_encrypt(&context, ctrNonce->ctrNonce, ctrNonce->cipherText);
+	crypt(context->subkeys, block, out);
+}
+
+void SEED_decrypt(const SeedContext* context, const uint32_t* block, uint32_t* out)
+{
+	crypt(context->decryptSubkeys, block, out);
+}
+
+void SEED_keySetup(SeedContext* context, const uint32_t* key, int key_size)
+{
+	// SEED_init rotates the key words in place, so work on a copy
+	uint32_t key32[4] = { key[0], key[1], key[2], key[3] };
+
+	SEED_init(context, key32);
+}
+
+/*
+	Runs the two states a and b (l0, l1, r0, r1) in place through the
+	rounds of subkeys together, so the G function table lookups of both
+	blocks overlap.
+*/
+static void cryptTwo(const uint32_t* subkeys, uint32_t* a, uint32_t* b)
+{
+	int round;
+	uint32_t temp0, temp1, temp2, temp3;
+	const uint32_t* subkey = subkeys;
+	uint32_t al0 = a[0], al1 = a[1], ar0 = a[2], ar1 = a[3];
+	uint32_t bl0 = b[0], bl1 = b[1], br0 = b[2], br1 = b[3];
+
+	for (round = 0; round < NR_ROUNDS - 1; round++)
+	{
+		F(ar0, ar1, subkey[0], subkey[1], &temp0, &temp1);
+		F(br0, br1, subkey[0], subkey[1], &temp2, &temp3);
+
+		temp0 ^= al0;
+		temp1 ^= al1;
+		temp2 ^= bl0;
+		temp3 ^= bl1;
+
+		al0 = ar0;
+		al1 = ar1;
+		bl0 = br0;
+		bl1 = br1;
+
+		ar0 = temp0;
+		ar1 = temp1;
+		br0 = temp2;
+		br1 = temp3;
+
+		subkey += 2;
+	}
+
+	// last round we update l instead of r
+	F(ar0, ar1, subkey[0], subkey[1], &temp0, &temp1);
+	F(br0, br1, subkey[0], subkey[1], &temp2, &temp3);
+
+	a[0] = al0 ^ temp0;
+	a[1] = al1 ^ temp1;
+	a[2] = ar0;
+	a[3] = ar1;
+	b[0] = bl0 ^ temp2;
+	b[1] = bl1 ^ temp3;
+	b[2] = br0;
+	b[3] = br1;
 }
+
+// Encrypts nrBlocks contiguous blocks of 4 words each
+void SEED_encryptBlocks(const SeedContext* context, const uint32_t* in, uint32_t* out, size_t nrBlocks)
+{
+	uint32_t a[4];
+	uint32_t b[4];
+	int j;
+	size_t i = 0;
+
+	for (; i + 2 <= nrBlocks; i += 2, in += 8, out += 8)
+	{
+		for (j = 0; j < 4; j++)
+		{
+			a[j] = in[j];
+			b[j] = in[4 + j];
+		}
+
+		cryptTwo(context->subkeys, a, b);
+
+		for (j = 0; j < 4; j++)
+		{
+			out[j] = a[j];
+			out[4 + j] = b[j];
+		}
+	}
+
+	if (i < nrBlocks)
+	{
+		SEED_encrypt((SeedContext*)context, (uint32_t*)in, out);
+	}
+}
+
+// Runs nrBlocks contiguous 16 bytes blocks through subkeys, loading the words directly
+static void cryptBytes(const uint32_t* subkeys, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	uint32_t a[4];
+	uint32_t b[4];
+	int j;
+	size_t i = 0;
+
+	for (; i + 2 <= nrBlocks; i += 2, in += 32, out += 32)
+	{
+		for (j = 0; j < 4; j++)
+		{
+			a[j] = LOAD32_BE(in + 4 * j);
+			b[j] = LOAD32_BE(in + 16 + 4 * j);
+		}
+
+		cryptTwo(subkeys, a, b);
+
+		for (j = 0; j < 4; j++)
+		{
+			STORE32_BE(out + 4 * j, a[j]);
+			STORE32_BE(out + 16 + 4 * j, b[j]);
+		}
+	}
+
+	if (i < nrBlocks)
+	{
+		for (j = 0; j < 4; j++)
+		{
+			a[j] = LOAD32_BE(in + 4 * j);
+		}
+
+		crypt(subkeys, a, a);
+
+		for (j = 0; j < 4; j++)
+		{
+			STORE32_BE(out + 4 * j, a[j]);
+		}
+	}
+}
+
+void SEED_encryptBytes(const SeedContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	cryptBytes(context->subkeys, in, out, nrBlocks);
+}
+
+void SEED_decryptBytes(const SeedContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	cryptBytes(context->decryptSubkeys, in, out, nrBlocks);
+}
+
+static void descriptorKeySetup(void* context, const uint32_t* key, int keySize)
+{
+	SEED_keySetup(context, key, keySize);
+}
+
+static void descriptorEncryptBlocks(const void* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	SEED_encryptBytes(context, in, out, nrBlocks);
+}
+
+static void descriptorDecryptBlocks(const void* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	SEED_decryptBytes(context, in, out, nrBlocks);
+}
+
+const CipherDescriptor SEED_descriptor =
+{
+	"SEED",
+	128,
+	{ 128, 0, 0 },
+	sizeof(SeedContext),
+	_Alignof(SeedContext),
+	descriptorKeySetup,
+	descriptorEncryptBlocks,
+	NULL,
+	NULL,
+	0,
+	0,
+	NULL,
+	NULL,
+	descriptorDecryptBlocks
+};
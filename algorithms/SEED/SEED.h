@@ -14,9 +14,17 @@
 typedef struct
 {
 	uint32_t subkeys[32];
+	uint32_t decryptSubkeys[32];
 } SeedContext;
 
 void SEED_init(SeedContext* context, uint32_t* key);
 void SEED_encrypt(SeedContext* context, uint32_t* block, uint32_t* out);
+void SEED_decrypt(const SeedContext* context, const uint32_t* block, uint32_t* out);
 
-void SEED_main(CTRCounter* ctrNonce, int key_size);
+void SEED_encryptBlocks(const SeedContext* context, const uint32_t* in, uint32_t* out, size_t nrBlocks);
+void SEED_encryptBytes(const SeedContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks);
+void SEED_decryptBytes(const SeedContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks);
+
+void SEED_keySetup(SeedContext* context, const uint32_t* key, int key_size);
+
+extern const CipherDescriptor SEED_descriptor;
@@ -17,7 +17,29 @@ typedef struct
 	uint64_t subkeys[72];
 } SimonContext;
 
+// number of keys encrypted side by side by SIMON_encryptLanes
+#define SIMON_LANES 4
+
+// round keys of SIMON_LANES contexts interleaved, see SIMON_loadLane
+typedef struct
+{
+	uint8_t nrSubkeys;
+	_Alignas(32) uint64_t subkeys[72][SIMON_LANES];
+} SimonLanes;
+
 void SIMON_init(SimonContext* context, uint64_t* key, uint16_t keyLen);
 void SIMON_encrypt(SimonContext* context, uint64_t* block, uint64_t* out);
+void SIMON_decrypt(const SimonContext* context, const uint64_t* block, uint64_t* out);
+
+void SIMON_encryptBlocks(const SimonContext* context, const uint64_t* in, uint64_t* out, size_t nrBlocks);
+void SIMON_encryptBytes(const SimonContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks);
+void SIMON_encryptBytesSimd(const SimonContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks);
+void SIMON_decryptBytes(const SimonContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks);
+
+void SIMON_loadLane(SimonLanes* lanes, int lane, const SimonContext* context);
+void SIMON_encryptLanes(const SimonLanes* lanes, const uint8_t* in, uint8_t* out, size_t nrBlocks);
+int SIMON_lanesSupported(void);
+
+void SIMON_keySetup(SimonContext* context, const uint32_t* key, int key_size);
 
-void SIMON_main(CTRCounter* ctrNonce, int key_size);
+extern const CipherDescriptor SIMON_descriptor;
@@ -17,6 +17,10 @@
 
 #include "SPECK.h"
 
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
 // Rotate Left circular shift 32 bits
 static uint64_t ROL_64(uint64_t x, uint32_t n)
 {
@@ -38,6 +42,16 @@ static void R(uint64_t* x, uint64_t* y, uint64_t k)
 	*y ^= *x;
 }
 
+// Inverse of R
+static void RINV(uint64_t* x, uint64_t* y, uint64_t k)
+{
+	*y ^= *x;
+	*y = ROR_64(*y, 3);
+	*x ^= k;
+	*x -= *y;
+	*x = ROL_64(*x, 8);
+}
+
 void SPECK_init(SpeckContext* context, uint64_t* key, uint16_t keyLen)
 {
 	uint64_t A;
@@ -113,61 +127,377 @@ void SPECK_encrypt(SpeckContext* context, uint64_t* block, uint64_t* out)
 	out[1] = y;
 }
 
-void SPECK_main(CTRCounter* ctrNonce, int key_size)
-{
-	SpeckContext context;
-	uint64_t key[4];
-	uint64_t text[2];
-	uint64_t cipherText[2];
-	uint64_t val0 = ctrNonce->ctrNonce[0];
-	uint64_t val1 = ctrNonce->ctrNonce[1];
-	uint64_t val2 = ctrNonce->ctrNonce[2];
-	uint64_t val3 = ctrNonce->ctrNonce[3];
-
-	uint64_t key0 = ctrNonce->Key[0];
-	uint64_t key1 = ctrNonce->Key[1];
-	uint64_t key2 = ctrNonce->Key[2];
-	uint64_t key3 = ctrNonce->Key[3];
-	uint64_t key4 = ctrNonce->Key[4];
-	uint64_t key5 = ctrNonce->Key[5];
-	uint64_t key6 = ctrNonce->Key[6];
-	uint64_t key7 = ctrNonce->Key[7];
-
-	text[0] = (val0 << 32) | val1;
-	text[1] = (val2 << 32) | val3;
-
-	switch (key_size)
-	{
-	case 128 :
-		key[0] = (key0 << 32) | key1;
-		key[1] = (key2 << 32) | key3;
-		key[2] = 0x0000000000000000;
-		key[3] = 0x0000000000000000;		
-		break;
-	case 192 :
-		key[0] = (key0 << 32) | key1;
-		key[1] = (key2 << 32) | key3;
-		key[2] = (key4 << 32) | key5;
-		key[3] = 0x0000000000000000;
-		break;
-	case 256 :
-		key[0] = (key0 << 32) | key1;
-		key[1] = (key2 << 32) | key3;
-		key[2] = (key4 << 32) | key5;
-		key[3] = (key6 << 32) | key7;
-		break;
-	
-	default:
-		break;
-	}
-
-	SPECK_init(&context, key, key_size);
-	SPECK_encrypt(&context, text, cipherText);
-
-	ctrNonce->cipherText[0] = (uint32_t)(cipherText[0] >> 32);
-	ctrNonce->cipherText[1] = (uint32_t)(cipherText[0]);
-	ctrNonce->cipherText[2] = (uint32_t)(cipherText[1] >> 32);
-	ctrNonce->cipherText[3] = (uint32_t)(cipherText[1]);
-	
-	return;
+void SPECK_decrypt(const SpeckContext* context, const uint64_t* block, uint64_t* out)
+{
+	int i;
+	uint64_t x = block[0];
+	uint64_t y = block[1];
+
+	for (i = context->nrSubkeys - 1; i >= 0; i--)
+	{
+		RINV(&x, &y, context->subkeys[i]);
+	}
+
+	out[0] = x;
+	out[1] = y;
+}
+
+void SPECK_keySetup(SpeckContext* context, const uint32_t* key, int key_size)
+{
+	uint64_t key64[4];
+	uint64_t key0 = key[0];
+	uint64_t key1 = key[1];
+	uint64_t key2 = key[2];
+	uint64_t key3 = key[3];
+
+	key64[0] = (key0 << 32) | key1;
+	key64[1] = (key2 << 32) | key3;
+	key64[2] = 0x0000000000000000;
+	key64[3] = 0x0000000000000000;
+
+	if (key_size >= 192)
+	{
+		key64[2] = ((uint64_t)key[4] << 32) | key[5];
+	}
+	if (key_size == 256)
+	{
+		key64[3] = ((uint64_t)key[6] << 32) | key[7];
+	}
+
+	SPECK_init(context, key64, key_size);
+}
+
+/*
+	Encrypts the two blocks a and b in place. Both blocks share every
+	round so each subkey is loaded once for both.
+*/
+static void encryptTwo(const SpeckContext* context, uint64_t* a, uint64_t* b)
+{
+	uint8_t r;
+	uint64_t x0 = a[0];
+	uint64_t y0 = a[1];
+	uint64_t x1 = b[0];
+	uint64_t y1 = b[1];
+
+	for (r = 0; r < context->nrSubkeys; r++)
+	{
+		R(&x0, &y0, context->subkeys[r]);
+		R(&x1, &y1, context->subkeys[r]);
+	}
+
+	a[0] = x0;
+	a[1] = y0;
+	b[0] = x1;
+	b[1] = y1;
+}
+
+// Encrypts nrBlocks contiguous blocks of 2 uint64_t each
+void SPECK_encryptBlocks(const SpeckContext* context, const uint64_t* in, uint64_t* out, size_t nrBlocks)
+{
+	uint64_t a[2];
+	uint64_t b[2];
+	size_t i = 0;
+
+	for (; i + 2 <= nrBlocks; i += 2, in += 4, out += 4)
+	{
+		a[0] = in[0];
+		a[1] = in[1];
+		b[0] = in[2];
+		b[1] = in[3];
+
+		encryptTwo(context, a, b);
+
+		out[0] = a[0];
+		out[1] = a[1];
+		out[2] = b[0];
+		out[3] = b[1];
+	}
+
+	if (i < nrBlocks)
+	{
+		SPECK_encrypt((SpeckContext*)context, (uint64_t*)in, out);
+	}
+}
+
+// Encrypts nrBlocks contiguous 16 bytes blocks, loading the halves directly
+void SPECK_encryptBytes(const SpeckContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	uint64_t a[2];
+	uint64_t b[2];
+	size_t i = 0;
+
+	for (; i + 2 <= nrBlocks; i += 2, in += 32, out += 32)
+	{
+		a[0] = LOAD64_BE(in);
+		a[1] = LOAD64_BE(in + 8);
+		b[0] = LOAD64_BE(in + 16);
+		b[1] = LOAD64_BE(in + 24);
+
+		encryptTwo(context, a, b);
+
+		STORE64_BE(out, a[0]);
+		STORE64_BE(out + 8, a[1]);
+		STORE64_BE(out + 16, b[0]);
+		STORE64_BE(out + 24, b[1]);
+	}
+
+	if (i < nrBlocks)
+	{
+		a[0] = LOAD64_BE(in);
+		a[1] = LOAD64_BE(in + 8);
+
+		SPECK_encrypt((SpeckContext*)context, a, a);
+
+		STORE64_BE(out, a[0]);
+		STORE64_BE(out + 8, a[1]);
+	}
+}
+
+// Decrypts the two blocks a and b in place, the subkeys in reverse order
+static void decryptTwo(const SpeckContext* context, uint64_t* a, uint64_t* b)
+{
+	int r;
+	uint64_t x0 = a[0];
+	uint64_t y0 = a[1];
+	uint64_t x1 = b[0];
+	uint64_t y1 = b[1];
+
+	for (r = context->nrSubkeys - 1; r >= 0; r--)
+	{
+		RINV(&x0, &y0, context->subkeys[r]);
+		RINV(&x1, &y1, context->subkeys[r]);
+	}
+
+	a[0] = x0;
+	a[1] = y0;
+	b[0] = x1;
+	b[1] = y1;
+}
+
+// Decrypts nrBlocks contiguous 16 bytes blocks, loading the halves directly
+void SPECK_decryptBytes(const SpeckContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	uint64_t a[2];
+	uint64_t b[2];
+	size_t i = 0;
+
+	for (; i + 2 <= nrBlocks; i += 2, in += 32, out += 32)
+	{
+		a[0] = LOAD64_BE(in);
+		a[1] = LOAD64_BE(in + 8);
+		b[0] = LOAD64_BE(in + 16);
+		b[1] = LOAD64_BE(in + 24);
+
+		decryptTwo(context, a, b);
+
+		STORE64_BE(out, a[0]);
+		STORE64_BE(out + 8, a[1]);
+		STORE64_BE(out + 16, b[0]);
+		STORE64_BE(out + 24, b[1]);
+	}
+
+	if (i < nrBlocks)
+	{
+		a[0] = LOAD64_BE(in);
+		a[1] = LOAD64_BE(in + 8);
+
+		SPECK_decrypt(context, a, a);
+
+		STORE64_BE(out, a[0]);
+		STORE64_BE(out + 8, a[1]);
+	}
+}
+
+/*
+	Multi key lanes: round key r of lane l is stored in subkeys[r][slot],
+	slot being 0, 2, 1, 3 for lanes 0 to 3, the order in which the AVX2
+	kernel unpacks four consecutive blocks into its x and y vectors.
+*/
+static int laneSlot(int lane)
+{
+	return ((lane & 1) << 1) | (lane >> 1);
+}
+
+void SPECK_loadLane(SpeckLanes* lanes, int lane, const SpeckContext* context)
+{
+	int slot = laneSlot(lane);
+
+	lanes->nrSubkeys = context->nrSubkeys;
+	for (int r = 0; r < context->nrSubkeys; r++)
+	{
+		lanes->subkeys[r][slot] = context->subkeys[r];
+	}
+}
+
+#ifdef __x86_64__
+
+#define ROL_256(x, n) _mm256_or_si256(_mm256_slli_epi64(x, n), _mm256_srli_epi64(x, 64 - (n)))
+#define ROR_256(x, n) _mm256_or_si256(_mm256_srli_epi64(x, n), _mm256_slli_epi64(x, 64 - (n)))
+
+// Encrypts nrBlocks groups of SPECK_LANES blocks, block l of a group with the key of lane l
+__attribute__((target("avx2")))
+void SPECK_encryptLanes(const SpeckLanes* lanes, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	// big endian 64 bits words to native order
+	const __m256i swap = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+										  7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+	__m256i v0, v1, x, y, k;
+	uint8_t r;
+
+	for (size_t g = 0; g < nrBlocks; g++, in += 64, out += 64)
+	{
+		// v0 = x0 y0 | x1 y1, v1 = x2 y2 | x3 y3
+		v0 = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)in), swap);
+		v1 = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(in + 32)), swap);
+
+		// x = x0 x2 | x1 x3, y = y0 y2 | y1 y3
+		x = _mm256_unpacklo_epi64(v0, v1);
+		y = _mm256_unpackhi_epi64(v0, v1);
+
+		for (r = 0; r < lanes->nrSubkeys; r++)
+		{
+			k = _mm256_load_si256((const __m256i*)lanes->subkeys[r]);
+			x = _mm256_xor_si256(_mm256_add_epi64(ROR_256(x, 8), y), k);
+			y = _mm256_xor_si256(ROL_256(y, 3), x);
+		}
+
+		_mm256_storeu_si256((__m256i*)out, _mm256_shuffle_epi8(_mm256_unpacklo_epi64(x, y), swap));
+		_mm256_storeu_si256((__m256i*)(out + 32), _mm256_shuffle_epi8(_mm256_unpackhi_epi64(x, y), swap));
+	}
+}
+
+/*
+	Encrypts nrBlocks contiguous blocks with one key, the round key
+	broadcast to every lane. Two groups of SPECK_LANES blocks per
+	iteration hide the latency of the rounds, the last blocks go through
+	the scalar kernel.
+*/
+__attribute__((target("avx2")))
+void SPECK_encryptBytesSimd(const SpeckContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	const __m256i swap = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+										  7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+	__m256i v0, v1, v2, v3, x0, y0, x1, y1, k;
+	size_t i = 0;
+	uint8_t r;
+
+	for (; i + 2 * SPECK_LANES <= nrBlocks; i += 2 * SPECK_LANES, in += 128, out += 128)
+	{
+		v0 = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)in), swap);
+		v1 = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(in + 32)), swap);
+		v2 = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(in + 64)), swap);
+		v3 = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(in + 96)), swap);
+
+		x0 = _mm256_unpacklo_epi64(v0, v1);
+		y0 = _mm256_unpackhi_epi64(v0, v1);
+		x1 = _mm256_unpacklo_epi64(v2, v3);
+		y1 = _mm256_unpackhi_epi64(v2, v3);
+
+		for (r = 0; r < context->nrSubkeys; r++)
+		{
+			k = _mm256_set1_epi64x((long long)context->subkeys[r]);
+			x0 = _mm256_xor_si256(_mm256_add_epi64(ROR_256(x0, 8), y0), k);
+			x1 = _mm256_xor_si256(_mm256_add_epi64(ROR_256(x1, 8), y1), k);
+			y0 = _mm256_xor_si256(ROL_256(y0, 3), x0);
+			y1 = _mm256_xor_si256(ROL_256(y1, 3), x1);
+		}
+
+		_mm256_storeu_si256((__m256i*)out, _mm256_shuffle_epi8(_mm256_unpacklo_epi64(x0, y0), swap));
+		_mm256_storeu_si256((__m256i*)(out + 32), _mm256_shuffle_epi8(_mm256_unpackhi_epi64(x0, y0), swap));
+		_mm256_storeu_si256((__m256i*)(out + 64), _mm256_shuffle_epi8(_mm256_unpacklo_epi64(x1, y1), swap));
+		_mm256_storeu_si256((__m256i*)(out + 96), _mm256_shuffle_epi8(_mm256_unpackhi_epi64(x1, y1), swap));
+	}
+
+	SPECK_encryptBytes(context, in, out, nrBlocks - i);
+}
+
+int SPECK_lanesSupported(void)
+{
+	return __builtin_cpu_supports("avx2");
+}
+
+#else
+
+// Portable lane kernel, one lane after the other
+void SPECK_encryptLanes(const SpeckLanes* lanes, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	uint64_t x, y;
+	uint8_t r;
+
+	for (size_t b = 0; b < nrBlocks * SPECK_LANES; b++, in += 16, out += 16)
+	{
+		int slot = laneSlot(b % SPECK_LANES);
+
+		x = LOAD64_BE(in);
+		y = LOAD64_BE(in + 8);
+
+		for (r = 0; r < lanes->nrSubkeys; r++)
+		{
+			R(&x, &y, lanes->subkeys[r][slot]);
+		}
+
+		STORE64_BE(out, x);
+		STORE64_BE(out + 8, y);
+	}
+}
+
+// No SIMD kernel, the scalar one
+void SPECK_encryptBytesSimd(const SpeckContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	SPECK_encryptBytes(context, in, out, nrBlocks);
+}
+
+int SPECK_lanesSupported(void)
+{
+	return 1;
+}
+
+#endif
+
+static void descriptorKeySetup(void* context, const uint32_t* key, int keySize)
+{
+	SPECK_keySetup(context, key, keySize);
+}
+
+static void descriptorEncryptBlocks(const void* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	SPECK_encryptBytes(context, in, out, nrBlocks);
 }
+
+static void descriptorEncryptBlocksSimd(const void* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	SPECK_encryptBytesSimd(context, in, out, nrBlocks);
+}
+
+static void descriptorLoadLane(void* lanes, int lane, const void* context)
+{
+	SPECK_loadLane(lanes, lane, context);
+}
+
+static void descriptorEncryptLanes(const void* lanes, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	SPECK_encryptLanes(lanes, in, out, nrBlocks);
+}
+
+static void descriptorDecryptBlocks(const void* context, const uint8_t* in, uint8_t* out, size_t nrBlocks)
+{
+	SPECK_decryptBytes(context, in, out, nrBlocks);
+}
+
+const CipherDescriptor SPECK_descriptor =
+{
+	"SPECK",
+	128,
+	{ 128, 192, 256 },
+	sizeof(SpeckContext),
+	_Alignof(SpeckContext),
+	descriptorKeySetup,
+	descriptorEncryptBlocks,
+	descriptorEncryptBlocksSimd,
+	SPECK_lanesSupported,
+	sizeof(SpeckLanes),
+	SPECK_LANES,
+	descriptorLoadLane,
+	descriptorEncryptLanes,
+	descriptorDecryptBlocks
+};
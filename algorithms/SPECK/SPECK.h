@@ -17,7 +17,29 @@ typedef struct
 	uint64_t subkeys[34];
 } SpeckContext;
 
+// number of keys encrypted side by side by SPECK_encryptLanes
+#define SPECK_LANES 4
+
+// round keys of SPECK_LANES contexts interleaved, see SPECK_loadLane
+typedef struct
+{
+	uint8_t nrSubkeys;
+	_Alignas(32) uint64_t subkeys[34][SPECK_LANES];
+} SpeckLanes;
+
 void SPECK_init(SpeckContext* context, uint64_t* key, uint16_t keyLen);
 void SPECK_encrypt(SpeckContext* context, uint64_t* block, uint64_t* out);
+void SPECK_decrypt(const SpeckContext* context, const uint64_t* block, uint64_t* out);
+
+void SPECK_encryptBlocks(const SpeckContext* context, const uint64_t* in, uint64_t* out, size_t nrBlocks);
+void SPECK_encryptBytes(const SpeckContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks);
+void SPECK_encryptBytesSimd(const SpeckContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks);
+void SPECK_decryptBytes(const SpeckContext* context, const uint8_t* in, uint8_t* out, size_t nrBlocks);
+
+void SPECK_loadLane(SpeckLanes* lanes, int lane, const SpeckContext* context);
+void SPECK_encryptLanes(const SpeckLanes* lanes, const uint8_t* in, uint8_t* out, size_t nrBlocks);
+int SPECK_lanesSupported(void);
+
+void SPECK_keySetup(SpeckContext* context, const uint32_t* key, int key_size);
 
-void SPECK_main(CTRCounter* ctrNonce, int key_size);
+extern const CipherDescriptor SPECK_descriptor;
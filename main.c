@@ -12,7 +12,21 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "CTRMode.h"
+#include "CTRParallel.h"
+#include "CTRPrecompute.h"
+#include "CTRBatch.h"
+#include "CTRJobManager.h"
+#include "CTRRekey.h"
+#include "CTRCascade.h"
+#include "CTRDrbg.h"
+#include "CTRGcm.h"
+#include "CTRPoly.h"
+#include "CTROcb.h"
+#include "CTRXts.h"
+#include "CTRCbc.h"
+#include "CTRCrc.h"
 #include "algorithms/ARIA/ARIA.h"
 #include "algorithms/CAMELLIA/CAMELLIA.h"
 #include "algorithms/NOEKEON/NOEKEON.h"
@@ -26,8 +40,12 @@
 
 #define TEXT_SIZE_64 2
 #define TEXT_SIZE_128 4
+#define MAX_TEXT_WORDS 256
 
-int readText(uint32_t* textList,char* fileRead){
+// shared by every Call_CTR, the threads are started once
+static CTRPool ctrPool;
+
+int readText(uint32_t* textList, int maxWords, char* fileRead){
 
 	uint32_t dataRead;
 	FILE *file;
@@ -39,7 +57,7 @@ int readText(uint32_t* textList,char* fileRead){
 		exit(1);
 	}
 
-	while(fscanf(file, "%x", &dataRead) != EOF){	
+	while(cont < maxWords && fscanf(file, "%x", &dataRead) != EOF){	
 		textList[cont] = dataRead;
 		cont++;
 	}
@@ -48,45 +66,421 @@ int readText(uint32_t* textList,char* fileRead){
 	return cont;
 }
 
+// prints length bytes of a block, grouped as big endian 32 bits words
+void printBlock(char* label, uint8_t* block, int length){
+	printf("%s", label);
+	for (int i = 0; i < length; i++)
+	{
+		printf("%02x", block[i]);
+		if (i % 4 == 3)
+		{
+			printf(" ");
+		}
+	}
+	printf("\n");
+}
+
 void Call_CTR(enum Algorithm algorithm, int SIZE, char* fileKey){
-	CTRCounter ctrCounter;
+	CTRContext ctrContext;
 
-	int contText = 0;
-	int contNonce = 0;	
+	uint32_t key[8] = { 0 };
+	uint32_t nonce[4] = { 0 };
+	uint8_t counter[16];
 
-	uint32_t textList[12];
-	uint32_t nonceList[12];
+	uint32_t textWords[MAX_TEXT_WORDS];
+	uint8_t textList[4 * MAX_TEXT_WORDS];
+	uint8_t cipherList[4 * MAX_TEXT_WORDS];
+	uint8_t decryptList[4 * MAX_TEXT_WORDS];
 	
-	int numText = readText(textList, "TextBlock.txt");
-	readText(nonceList, "NonceBlock.txt");
-	readText(ctrCounter.Key, fileKey);
-
-	do{
-
-		printf("Text : \t\t\t"); 
-		for (int i = 0; i < SIZE; i++)
-		{			
-			ctrCounter.text[i] = textList[contText];
-			printf("%08x ", ctrCounter.text[i]); 
-			contText++;
+	int numText = readText(textWords, MAX_TEXT_WORDS, "TextBlock.txt");
+	// only the first block is used: nonce || counter, incremented for each block
+	readText(nonce, SIZE, "NonceBlock.txt");
+	readText(key, 8, fileKey);
+
+	// the whole text, the last block may be partial
+	int length = 4 * numText;
+	int blockBytes = 4 * SIZE;
+
+	// the modes work on bytes, the text file holds big endian words
+	for (int i = 0; i < numText; i++)
+	{
+		STORE32_BE(&textList[4 * i], textWords[i]);
+	}
+
+	// ENCRYPT SIDE, in place
+	memcpy(cipherList, textList, length);
+	CTRMode_init(&ctrContext, algorithm, key, nonce);
+	CTRMode_update(&ctrContext, cipherList, cipherList, length);
+	CTRMode_final(&ctrContext);
+
+	// DECRYPT SIDE: parallel path, must give back the same bytes
+	memcpy(decryptList, cipherList, length);
+	CTRMode_init(&ctrContext, algorithm, key, nonce);
+	CTRMode_updateParallel(&ctrContext, &ctrPool, decryptList, decryptList, length);
+	CTRMode_final(&ctrContext);
+
+	for (int offset = 0; offset < length; offset += blockBytes)
+	{
+		int n = (length - offset < blockBytes) ? length - offset : blockBytes;
+
+		CTRMode_counterBlocks(nonce, SIZE, SIZE, counter, 1);
+
+		printBlock("Text : \t\t\t", &textList[offset], n);
+		printBlock("Counter: \t\t", counter, blockBytes);
+		printBlock("Cypher after XOR: \t", &cipherList[offset], n);
+		printBlock("Decrypt: \t\t", &decryptList[offset], n);
+		printf("\n");
+	}
+}
+
+/*
+	SELF CHECKS
+*/
+
+// 8 MiB, far above CTR_PARALLEL_MIN_BLOCKS, so the pool really splits the work
+#define PARALLEL_CHECK_SIZE (8u << 20)
+
+static int failedChecks = 0;
+
+static void check(char* label, int passed){
+	printf("%s%s\n", label, passed ? "PASS" : "FAIL");
+	if (!passed)
+	{
+		failedChecks++;
+	}
+}
+
+// compares length bytes with a hexadecimal string
+static int matches(const uint8_t* bytes, const char* hex, int length){
+	unsigned int value;
+
+	for (int i = 0; i < length; i++)
+	{
+		if (sscanf(hex + 2 * i, "%2x", &value) != 1 || bytes[i] != value)
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// the same deterministic bytes as the vector generators
+static void fillVectors(uint8_t* key, uint8_t* key2, uint8_t* iv, uint8_t* aad, uint8_t* text){
+	for (int i = 0; i < 32; i++)
+	{
+		key[i] = i;
+		aad[i] = 0xa0 + i;
+	}
+	for (int i = 0; i < 16; i++)
+	{
+		key2[i] = 0xf0 - i;
+	}
+	for (int i = 0; i < 64; i++)
+	{
+		iv[i] = 0x10 + 3 * i;
+	}
+	for (int i = 0; i < 80; i++)
+	{
+		text[i] = (uint8_t)(7 * i + 1);
+	}
+}
+
+static void loadWords(uint32_t* words, const uint8_t* bytes, int nrWords){
+	for (int i = 0; i < nrWords; i++)
+	{
+		words[i] = LOAD32_BE(bytes + 4 * i);
+	}
+}
+
+// known answers of every mode, and the CTR paths against one serial update
+void Check_Modes(){
+	uint8_t keyBytes[32], key2Bytes[16], iv[64], aad[32], text[80];
+	uint8_t cipher[80], plain[80], tag[16], block[16];
+	uint32_t key[8], key2[4], nonce[4];
+	CTRContext ctrContext;
+	CTRKey ctrKey;
+
+	fillVectors(keyBytes, key2Bytes, iv, aad, text);
+	loadWords(key, keyBytes, 8);
+	loadWords(key2, key2Bytes, 4);
+
+	// CTR, the counter carries out of its last two bytes after the first block,
+	// vector from OpenSSL ARIA-128-CTR
+	memcpy(block, iv, 16);
+	block[14] = 0xff;
+	block[15] = 0xff;
+	loadWords(nonce, block, 4);
+	CTRMode_init(&ctrContext, ARIA_128, key, nonce);
+	CTRMode_update(&ctrContext, text, cipher, 80);
+	CTRMode_final(&ctrContext);
+	check("CTR ARIA-128 known answer: \t", matches(cipher,
+		"e9e045becea24e0de07886cf3652d9378d940126748270fc04c5c4e530899c07"
+		"93cceb6f7f14cedb2467542139c3dd79ae36194a96933e9f11f855a1b2930dd7"
+		"82d2d46fa0e432d2b879bcbb5ca99eb7", 80));
+
+	// seek to an odd offset, then iovec fragments cut at other places
+	{
+		uint8_t part[80];
+		struct iovec in[3] = { { text, 5 }, { text + 5, 40 }, { text + 45, 35 } };
+		struct iovec out[2] = { { part, 33 }, { part + 33, 47 } };
+
+		CTRMode_init(&ctrContext, ARIA_128, key, nonce);
+		CTRMode_seek(&ctrContext, 37);
+		CTRMode_update(&ctrContext, text + 37, part, 43);
+		check("CTR seek: \t\t\t", memcmp(part, cipher + 37, 43) == 0);
+
+		CTRMode_seek(&ctrContext, 0);
+		check("CTR iovec: \t\t\t", CTRMode_updatev(&ctrContext, in, 3, out, 2) == 80 && memcmp(part, cipher, 80) == 0);
+		CTRMode_final(&ctrContext);
+	}
+
+	// CBC, vector from OpenSSL ARIA-128-CBC
+	memcpy(block, iv, 16);
+	CTRKey_init(&ctrKey, ARIA_128, key);
+	CTRCbc_encrypt(&ctrKey, block, text, cipher, 64);
+	check("CBC ARIA-128 known answer: \t", matches(cipher,
+		"b6e15aff39bf3d2f12436f2c390b80c0e867be86958e31ad0f9d2ce01cf5d716"
+		"266d1f878eef6d2e7d3bd20045153dbb641edf6092b01c1625276512adc755f9", 64));
+	memcpy(block, iv, 16);
+	CTRCbc_decrypt(&ctrKey, block, cipher, plain, 64);
+	check("CBC ARIA-128 decrypt: \t\t", memcmp(plain, text, 64) == 0);
+	CTRKey_final(&ctrKey);
+
+	// GCM, a 96 bits IV and a 60 bytes one hashed by GHASH,
+	// vectors from OpenSSL ARIA-128-GCM
+	{
+		CTRGcm gcm;
+
+		CTRGcm_init(&gcm, ARIA_128, key);
+		CTRGcm_encrypt(&gcm, iv, 12, aad, 20, text, cipher, 60, tag);
+		check("GCM ARIA-128 known answer: \t", matches(cipher,
+			"ce5510d063678d6c4595214a84e856ed82ddab8bd5e48b250a1c8e69e24dfadb"
+			"6f1c0bc28c9127c04ca08b35fa69957717ca1be0c0edbb1018a140e5", 60)
+			&& matches(tag, "b4af8743293657649d763c987a4c19ca", 16));
+		check("GCM ARIA-128 decrypt: \t\t", CTRGcm_decrypt(&gcm, iv, 12, aad, 20, cipher, plain, 60, tag, 16) == 0
+			&& memcmp(plain, text, 60) == 0);
+		check("GCM short tag refused: \t\t", CTRGcm_decrypt(&gcm, iv, 12, aad, 20, cipher, plain, 60, tag, 8) != 0);
+		cipher[7] ^= 1;
+		check("GCM forgery refused: \t\t", CTRGcm_decrypt(&gcm, iv, 12, aad, 20, cipher, plain, 60, tag, 16) != 0);
+
+		CTRGcm_encrypt(&gcm, iv, 60, aad, 20, text, cipher, 60, tag);
+		check("GCM ARIA-128 long IV: \t\t", matches(cipher,
+			"26baacde83a518c24828b34a3a7da5c19f3baf149dcee8d9ffc3922887971f3d"
+			"085d9be0c53fabfb3c8f79a2ff8ef98e32d34f69f145bd511a8ca7f6", 60)
+			&& matches(tag, "030621b8b2094c304fb1d202f0b9a596", 16));
+		CTRGcm_final(&gcm);
+	}
+
+	// OCB, with a partial last block, vector from OpenSSL OCB over its
+	// Camellia block function (the library has no AES for RFC 7253)
+	{
+		CTROcb ocb;
+
+		CTROcb_init(&ocb, CAMELLIA_128, key);
+		CTROcb_encrypt(&ocb, iv, 12, aad, 24, text, cipher, 40, tag);
+		check("OCB CAMELLIA-128 known answer: \t", matches(cipher,
+			"c7a14d2133ec14dc34bc8ec919ba09885f9ef9a930300d7bd583f80febe5f1b1"
+			"3163a0b6d3bc7065", 40)
+			&& matches(tag, "76661ddeafdb5f5fd4e9128044b34e2b", 16));
+		check("OCB CAMELLIA-128 decrypt: \t", CTROcb_decrypt(&ocb, iv, 12, aad, 24, cipher, plain, 40, tag) == 0
+			&& memcmp(plain, text, 40) == 0);
+		CTROcb_final(&ocb);
+	}
+
+	// XTS, a 40 bytes sector ends with ciphertext stealing,
+	// vector from OpenSSL XTS over its Camellia block function
+	{
+		CTRXts xts;
+
+		CTRXts_init(&xts, CAMELLIA_128, key, key2, 40);
+		CTRXts_encryptSector(&xts, 0x123456789aull, text, cipher);
+		check("XTS CAMELLIA-128 known answer: \t", matches(cipher,
+			"619c1855f070e9a5a9fbfc15402016903aa1802a2802eec223584e5b47804260"
+			"7d63015da7ae4da2", 40));
+		CTRXts_decryptSector(&xts, 0x123456789aull, cipher, plain);
+		check("XTS CAMELLIA-128 decrypt: \t", memcmp(plain, text, 40) == 0);
+		CTRXts_final(&xts);
+	}
+
+	// Poly1305 AEAD on a 64 bits cipher, tag from OpenSSL's Poly1305
+	// over the IDEA key stream
+	{
+		CTRPoly poly;
+		uint8_t counter[CTR_POLY_NONCE_SIZE] = { 0x00, 0x00, 0x00, 0x2a };
+		uint32_t ideaKey[8];
+
+		// IDEA takes its key as eight 16 bits words
+		for (int i = 0; i < 8; i++)
+		{
+			ideaKey[i] = (keyBytes[2 * i] << 8) | keyBytes[2 * i + 1];
 		}
 
-		printf("\nNonce: \t\t\t"); 
-		
-		for (int i = 0; i < SIZE; i++)
-		{			
-			ctrCounter.ctrNonce[i] = nonceList[contNonce];
-			printf("%08x ", ctrCounter.ctrNonce[i]);  
-			contNonce++;
+		CTRPoly_init(&poly, IDEA_128, ideaKey);
+		CTRPoly_encrypt(&poly, counter, aad, 20, text, cipher, 50, tag);
+		check("POLY IDEA-128 known answer: \t", matches(cipher,
+			"6e3bf60c10b28a83156c1fd01ec841fd942b4d4e3557dcb6335370885bdf256b"
+			"fa0c486b0126730f697758786a30843950f7", 50)
+			&& matches(tag, "056291a47765df83be70597761f61da4", 16));
+		check("POLY IDEA-128 decrypt: \t\t", CTRPoly_decrypt(&poly, counter, aad, 20, cipher, plain, 50, tag) == 0
+			&& memcmp(plain, text, 50) == 0);
+		CTRPoly_final(&poly);
+	}
+
+	// CTR_DRBG: instantiate, reseed, two generates, vector from a plain
+	// SP 800-90A implementation over OpenSSL's ARIA
+	{
+		CTRDrbg drbg;
+		uint8_t entropy[32], reseed[32], personalization[32], additional[32], random[64];
+
+		for (int i = 0; i < 32; i++)
+		{
+			entropy[i] = 0x40 + i;
+			reseed[i] = 0x80 + i;
+			personalization[i] = 0xc0 + i;
+			additional[i] = 0x55 ^ i;
 		}
 
-		CTRMode_main(ctrCounter, algorithm, SIZE);
+		CTRDrbg_init(&drbg, ARIA_128, entropy, personalization, 32);
+		CTRDrbg_reseed(&drbg, reseed, additional, 32);
+		CTRDrbg_generate(&drbg, random, 64, NULL, 0);
+		CTRDrbg_generate(&drbg, random, 64, additional, 32);
+		check("DRBG ARIA-128 known answer: \t", matches(random,
+			"3b34c07667ae79a7700ed04b0e90f45fabbafe88e6041f009066efc3d3361696"
+			"70e7966c0570f18c6fa2de2830a9ff0e6423146726d3315e78490a9682955743", 64));
+		CTRDrbg_final(&drbg);
+	}
 
-	}while (contText < numText);	
+	check("CRC32C known answer: \t\t", CTRCrc_update(0, (const uint8_t*)"123456789", 9) == 0xe3069283);
+}
+
+// batch and job manager against one CTRState per message
+void Check_Messages(enum Algorithm algorithm){
+	uint32_t key[8] = { 0 };
+	uint32_t nonces[3][4] = { { 1, 2, 3, 4 }, { 5, 6, 7, 8 }, { 9, 10, 11, 12 } };
+	size_t lengths[3] = { 1000, 17, 4099 };
+	uint8_t* in = malloc(3 * 4099);
+	uint8_t* expected = malloc(3 * 4099);
+	uint8_t* out = malloc(3 * 4099);
+	CTRMessage messages[3];
+	CTRJob jobs[3];
+	CTRJobManager manager;
+	CTRState state;
+	CTRKey ctrKey;
+	int batchOk = 1, jobsOk = 1;
+
+	for (int i = 0; i < 8; i++)
+	{
+		key[i] = 0x01020304u * (i + 1);
+	}
+	for (int i = 0; i < 3 * 4099; i++)
+	{
+		in[i] = (uint8_t)(i * 13 + 5);
+	}
+
+	CTRKey_init(&ctrKey, algorithm, key);
+	for (int m = 0; m < 3; m++)
+	{
+		CTRState_init(&state, &ctrKey, nonces[m]);
+		CTRState_update(&state, in + m * 4099, expected + m * 4099, lengths[m]);
+
+		messages[m].nonce = nonces[m];
+		messages[m].in = in + m * 4099;
+		messages[m].out = out + m * 4099;
+		messages[m].length = lengths[m];
+	}
+
+	CTRKey_updateBatch(&ctrKey, messages, 3);
+	for (int m = 0; m < 3; m++)
+	{
+		batchOk &= memcmp(out + m * 4099, expected + m * 4099, lengths[m]) == 0;
+	}
+	check("CTR batch: \t\t\t", batchOk);
+
+	memset(out, 0, 3 * 4099);
+	CTRJobManager_init(&manager, algorithm);
+	for (int m = 0; m < 3; m++)
+	{
+		jobs[m].key = &ctrKey;
+		jobs[m].nonce = nonces[m];
+		jobs[m].in = in + m * 4099;
+		jobs[m].out = out + m * 4099;
+		jobs[m].length = lengths[m];
+		CTRJobManager_submit(&manager, &jobs[m]);
+	}
+	while (CTRJobManager_flush(&manager) != NULL)
+	{
+	}
+	for (int m = 0; m < 3; m++)
+	{
+		jobsOk &= jobs[m].status == 0 && memcmp(out + m * 4099, expected + m * 4099, lengths[m]) == 0;
+	}
+	check("CTR job manager: \t\t", jobsOk);
+	CTRJobManager_final(&manager);
+
+	CTRKey_final(&ctrKey);
+	free(in);
+	free(expected);
+	free(out);
+}
+
+// multi-megabyte buffer through the pool against the serial paths
+void Check_Parallel(enum Algorithm algorithm){
+	uint32_t key[8] = { 0 };
+	uint32_t nonce[4] = { 0x00112233, 0x44556677, 0x8899aabb, 0xccddeeff };
+	uint8_t iv[16] = { 0 };
+	uint8_t* text = malloc(PARALLEL_CHECK_SIZE);
+	uint8_t* serial = malloc(PARALLEL_CHECK_SIZE);
+	uint8_t* parallel = malloc(PARALLEL_CHECK_SIZE);
+	CTRContext ctrContext;
+	CTRKey ctrKey;
+	uint32_t crc;
+
+	for (int i = 0; i < 8; i++)
+	{
+		key[i] = 0x0f1e2d3cu * (i + 1);
+	}
+	for (size_t i = 0; i < PARALLEL_CHECK_SIZE; i++)
+	{
+		text[i] = (uint8_t)(i * 31 + (i >> 12));
+	}
+
+	// an odd length, the last block is partial
+	CTRMode_init(&ctrContext, algorithm, key, nonce);
+	CTRMode_update(&ctrContext, text, serial, PARALLEL_CHECK_SIZE - 3);
+	CTRMode_final(&ctrContext);
+
+	CTRMode_init(&ctrContext, algorithm, key, nonce);
+	CTRMode_updateParallel(&ctrContext, &ctrPool, text, parallel, PARALLEL_CHECK_SIZE - 3);
+	CTRMode_final(&ctrContext);
+	check("CTR 8 MiB parallel = serial: \t", memcmp(serial, parallel, PARALLEL_CHECK_SIZE - 3) == 0);
+
+	// the fused CRC is the CRC of the ciphertext
+	CTRMode_init(&ctrContext, algorithm, key, nonce);
+	crc = CTRCrc_encrypt(&ctrContext.state, text, parallel, PARALLEL_CHECK_SIZE - 3, 0);
+	CTRMode_final(&ctrContext);
+	check("CTR + CRC32C 8 MiB: \t\t", crc == CTRCrc_update(0, serial, PARALLEL_CHECK_SIZE - 3)
+		&& memcmp(serial, parallel, PARALLEL_CHECK_SIZE - 3) == 0);
+
+	CTRKey_init(&ctrKey, algorithm, key);
+	CTREcb_encrypt(&ctrKey, text, serial, PARALLEL_CHECK_SIZE);
+	CTREcb_encryptParallel(&ctrPool, &ctrKey, text, parallel, PARALLEL_CHECK_SIZE);
+	check("ECB 8 MiB parallel = serial: \t", memcmp(serial, parallel, PARALLEL_CHECK_SIZE) == 0);
+
+	CTRCbc_encrypt(&ctrKey, iv, text, serial, PARALLEL_CHECK_SIZE);
+	memset(iv, 0, sizeof(iv));
+	CTRCbc_decryptParallel(&ctrPool, &ctrKey, iv, serial, parallel, PARALLEL_CHECK_SIZE);
+	check("CBC 8 MiB parallel decrypt: \t", memcmp(text, parallel, PARALLEL_CHECK_SIZE) == 0);
+	CTRKey_final(&ctrKey);
+
+	free(text);
+	free(serial);
+	free(parallel);
 }
 
 int main()
 {
+	CTRPool_init(&ctrPool, 0);
+
 	// TEXT SIZE 128-bits
 
 	printf("\n\t-----ARIA 128-bits :----- \n"); 
@@ -143,5 +537,20 @@ int main()
 	printf("\n\t-----GOST 256-bits :-----\n");
 	Call_CTR(GOST_256, TEXT_SIZE_64, "Keys/GOST_256.txt");
 
-	return 0;	
+
+	printf("\n\t-----SELF CHECKS :-----\n");
+	Check_Modes();
+
+	printf("\n\t-----ARIA 128-bits :----- \n");
+	Check_Messages(ARIA_128);
+	Check_Parallel(ARIA_128);
+	printf("\n\t-----SPECK 128-bits :----- \n");
+	Check_Messages(SPECK_128);
+	Check_Parallel(SPECK_128);
+	printf("\n\t-----IDEA 128-bits :-----\n");
+	Check_Messages(IDEA_128);
+	Check_Parallel(IDEA_128);
+
+	CTRPool_final(&ctrPool);
+	return failedChecks != 0;
 }